@@ -0,0 +1,217 @@
+#include "libserver/base/IoContextPool.hpp"
+#include "libserver/base/Server.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <latch>
+#include <thread>
+
+namespace {
+
+//! Settings of the benchmark.
+struct BenchSettings
+{
+  //! Number of the connected clients.
+  std::size_t clientCount = 64;
+  //! Number of the frames each client sends.
+  std::size_t frameCount = 100'000;
+  //! Size of a frame, similar to a ranch snapshot command.
+  std::size_t frameSize = 64;
+  //! Number of the frames a client sends before it waits for their echoes.
+  std::size_t pipelineDepth = 16;
+  //! Number of the I/O threads of the server.
+  std::size_t ioThreads = 2;
+  //! Port of the server.
+  uint16_t port = 10099;
+};
+
+//! Client sending the frames and reading back their echoes.
+class BenchClient
+{
+public:
+  BenchClient(
+    boost::asio::io_context& ioContext,
+    const BenchSettings& settings,
+    std::latch& finished)
+    : _settings(settings)
+    , _finished(finished)
+    , _socket(ioContext)
+    , _writeBuffer(settings.frameSize * settings.pipelineDepth)
+    , _readBuffer(settings.frameSize * settings.pipelineDepth)
+  {
+  }
+
+  //! Connects the client to the server.
+  void Connect()
+  {
+    _socket.connect({boost::asio::ip::address_v4::loopback(), _settings.port});
+    _socket.set_option(boost::asio::ip::tcp::no_delay(true));
+  }
+
+  //! Sends the next batch of the frames.
+  void Run()
+  {
+    if (_sentCount == _settings.frameCount)
+    {
+      _finished.count_down();
+      return;
+    }
+
+    const std::size_t batchSize = std::min(
+      _settings.pipelineDepth,
+      _settings.frameCount - _sentCount);
+    _sentCount += batchSize;
+
+    const std::size_t size = batchSize * _settings.frameSize;
+    boost::asio::async_write(
+      _socket,
+      boost::asio::buffer(_writeBuffer.data(), size),
+      [this, size](const boost::system::error_code& error, std::size_t)
+      {
+        if (error)
+        {
+          spdlog::error("Couldn't write the frames: {}", error.message());
+          _finished.count_down();
+          return;
+        }
+
+        boost::asio::async_read(
+          _socket,
+          boost::asio::buffer(_readBuffer.data(), size),
+          [this](const boost::system::error_code& error, std::size_t)
+          {
+            if (error)
+            {
+              spdlog::error("Couldn't read the echoes: {}", error.message());
+              _finished.count_down();
+              return;
+            }
+
+            Run();
+          });
+      });
+  }
+
+private:
+  const BenchSettings& _settings;
+  std::latch& _finished;
+  boost::asio::ip::tcp::socket _socket;
+  std::vector<std::byte> _writeBuffer;
+  std::vector<std::byte> _readBuffer;
+  std::size_t _sentCount = 0;
+};
+
+//! Parses the settings from the arguments,
+//! the client count, the frame count, the frame size, the I/O thread count and the port.
+BenchSettings ParseSettings(int argc, char** argv)
+{
+  BenchSettings settings;
+  const auto parse = [argc, argv](int index, auto& value)
+  {
+    if (index < argc)
+    {
+      value = static_cast<std::remove_reference_t<decltype(value)>>(
+        std::strtoull(argv[index], nullptr, 10));
+    }
+  };
+
+  parse(1, settings.clientCount);
+  parse(2, settings.frameCount);
+  parse(3, settings.frameSize);
+  parse(4, settings.ioThreads);
+  parse(5, settings.port);
+  return settings;
+}
+
+} // namespace anon
+
+//! Benchmark of the networking backend of the server.
+//! The clients send fixed-size frames over the loopback, and the server
+//! echoes each frame as a separate write, as it does with the commands.
+int main(int argc, char** argv)
+{
+  const BenchSettings settings = ParseSettings(argc, argv);
+  spdlog::set_level(spdlog::level::warn);
+
+  alicia::IoContextPool ioContextPool(settings.ioThreads);
+
+  // Echo of a frame, shared by all the writes.
+  const auto echoBuffer = std::make_shared<const std::vector<std::byte>>(settings.frameSize);
+
+  alicia::Server* serverPtr = nullptr;
+  alicia::Server server(
+    ioContextPool,
+    [](alicia::ClientId)
+    {
+    },
+    [](alicia::ClientId)
+    {
+    },
+    [&serverPtr, &settings, &echoBuffer](alicia::ClientId clientId, std::span<std::byte> data)
+    {
+      const std::size_t frameCount = data.size() / settings.frameSize;
+      for (std::size_t idx = 0; idx < frameCount; ++idx)
+      {
+        serverPtr->QueueWrite(clientId, echoBuffer);
+      }
+
+      return frameCount * settings.frameSize;
+    });
+  serverPtr = &server;
+  server.Host(boost::asio::ip::address_v4::loopback(), settings.port);
+
+  std::jthread serverThread(
+    [&ioContextPool]()
+    {
+      ioContextPool.Run();
+    });
+
+  // The clients run on their own threads, with the same backend as the server.
+  boost::asio::io_context clientContext;
+  std::latch finished(static_cast<std::ptrdiff_t>(settings.clientCount));
+
+  std::vector<std::unique_ptr<BenchClient>> clients;
+  for (std::size_t idx = 0; idx < settings.clientCount; ++idx)
+  {
+    auto& client = clients.emplace_back(
+      std::make_unique<BenchClient>(clientContext, settings, finished));
+    client->Connect();
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  for (auto& client : clients)
+  {
+    client->Run();
+  }
+
+  std::vector<std::jthread> clientThreads;
+  for (std::size_t idx = 0; idx < settings.ioThreads; ++idx)
+  {
+    clientThreads.emplace_back(
+      [&clientContext]()
+      {
+        clientContext.run();
+      });
+  }
+
+  finished.wait();
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+  const double frameCount = static_cast<double>(settings.clientCount * settings.frameCount);
+  const double byteCount = frameCount * static_cast<double>(settings.frameSize) * 2.0;
+  spdlog::warn(
+    "Backend {}: {} clients echoed {} frames of {} bytes in {:.3f} s, {:.0f} frames/s, {:.1f} MiB/s",
+    alicia::IoContextPool::GetBackendName(),
+    settings.clientCount,
+    static_cast<std::size_t>(frameCount),
+    settings.frameSize,
+    elapsed.count(),
+    frameCount / elapsed.count(),
+    byteCount / elapsed.count() / (1024.0 * 1024.0));
+
+  clientContext.stop();
+  ioContextPool.Stop();
+}
@@ -45,11 +45,18 @@
   DEFINE_WRITER_READER(x, x::Write, x::Read)
 
 #include <boost/asio.hpp>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <functional>
 #include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace alicia
 {
@@ -70,6 +77,25 @@ WinFileTime UnixTimeToFileTime(const std::chrono::system_clock::time_point& time
 
 asio::ip::address_v4 ResolveHostName(const std::string& host);
 
+//! Converts the value between the native and the little-endian byte order.
+//!
+//! @param value Value to convert.
+//! @tparam T Type of value.
+//! @return Converted value.
+template <typename T> [[nodiscard]] constexpr T ToLittleEndian(T value) noexcept
+{
+  if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1)
+  {
+    return value;
+  }
+  else
+  {
+    auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+    std::ranges::reverse(bytes);
+    return std::bit_cast<T>(bytes);
+  }
+}
+
 template <typename StorageType> class StreamBase
 {
 public:
@@ -84,12 +110,9 @@ public:
   explicit StreamBase(nullptr_t) noexcept
       : _storage() {};
 
-  //! Virtual destructor.
-  virtual ~StreamBase() = default;
-
   //! Seeks to the cursor specified.
   //! @param cursor Cursor position.
-  virtual void Seek(std::size_t cursor)
+  void Seek(std::size_t cursor)
   {
     if (cursor > _storage.size())
     {
@@ -101,11 +124,11 @@ public:
 
   //! Gets the size of the underlying storage.
   //! @returns Size fo the underlying storage.
-  [[nodiscard]] virtual std::size_t Size() const { return _storage.size(); }
+  [[nodiscard]] std::size_t Size() const { return _storage.size(); }
 
   //! Gets the cursor of the storage.
   //! @returns Cursor position.
-  [[nodiscard]] virtual std::size_t GetCursor() const { return _cursor; }
+  [[nodiscard]] std::size_t GetCursor() const { return _cursor; }
 
 protected:
   Storage _storage;
@@ -122,14 +145,16 @@ public:
   //! Default constructor
   //!
   //! @param buffer Underlying storage buffer.
-  explicit SinkStream(Storage buffer) noexcept;
+  explicit SinkStream(Storage buffer) noexcept
+      : StreamBase(buffer) {};
   //! Empty constructor
-  explicit SinkStream(nullptr_t) noexcept;
+  explicit SinkStream(nullptr_t) noexcept
+      : StreamBase(nullptr) {};
 
   //! Move constructor.
-  SinkStream(SinkStream&&) noexcept;
+  SinkStream(SinkStream&&) noexcept = default;
   //! Move assignment.
-  SinkStream& operator=(SinkStream&&) noexcept;
+  SinkStream& operator=(SinkStream&&) noexcept = default;
 
   //! Deleted copy constructor.
   SinkStream(const SinkStream&) = delete;
@@ -141,7 +166,19 @@ public:
   //!
   //! @param data Data.
   //! @param size Size of data.
-  void Write(const void* data, std::size_t size);
+  void Write(const void* data, std::size_t size)
+  {
+    if (size > _storage.size() - _cursor)
+    {
+      ThrowOverflow(size);
+    }
+
+    if (size > 0)
+    {
+      std::memcpy(_storage.data() + _cursor, data, size);
+      _cursor += size;
+    }
+  }
 
   //! Write a value to the sink stream.
   //!
@@ -153,20 +190,38 @@ public:
     StreamWriter<T>{}(value, *this);
     return *this;
   }
+
+private:
+  //! Throws the overflow error, kept out of line of the writes.
+  [[noreturn]] void ThrowOverflow(std::size_t size) const;
 };
 
 //! General binary stream writer.
 //! Writes a little-endian byte sequence to the provided sink buffer.
+//! Types which are not trivially copyable require a specialization.
 //!
 //! @tparam T Type of value.
 template <typename T> struct StreamWriter
 {
+  static_assert(
+    std::is_trivially_copyable_v<T>,
+    "The general stream writer requires a trivially copyable type");
+
   void operator()(const T& value, SinkStream& buffer)
   {
-    const auto requiredByteCount = sizeof(value);
-
-    // Write the value to the buffer.
-    buffer.Write(reinterpret_cast<const void*>(&value), requiredByteCount);
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+    {
+      const T littleEndianValue = ToLittleEndian(value);
+      buffer.Write(&littleEndianValue, sizeof(value));
+    }
+    else
+    {
+      // Compound types are written as they are laid out in memory.
+      static_assert(
+        std::endian::native == std::endian::little || sizeof(T) == 1,
+        "Compound types require a writer specialization on big-endian hosts");
+      buffer.Write(&value, sizeof(value));
+    }
   }
 };
 
@@ -180,14 +235,16 @@ public:
   //! Default constructor
   //!
   //! @param stream Source buffer.
-  explicit SourceStream(Storage buffer);
+  explicit SourceStream(Storage buffer) noexcept
+      : StreamBase(buffer) {};
   //! Empty constructor
-  explicit SourceStream(nullptr_t);
+  explicit SourceStream(nullptr_t) noexcept
+      : StreamBase(nullptr) {};
 
   //! Move constructor
-  SourceStream(SourceStream&& rhs) noexcept;
+  SourceStream(SourceStream&& rhs) noexcept = default;
   //! Move assignment.
-  SourceStream& operator=(SourceStream&&) noexcept;
+  SourceStream& operator=(SourceStream&&) noexcept = default;
 
   //! Deleted copy constructor.
   SourceStream(const SourceStream&) = delete;
@@ -199,7 +256,26 @@ public:
   //!
   //! @param data Data.
   //! @param size Size of data.
-  void Read(void* data, std::size_t size);
+  void Read(void* data, std::size_t size)
+  {
+    if (size > _storage.size() - _cursor)
+    {
+      ThrowOverflow(size);
+    }
+
+    if (size > 0)
+    {
+      std::memcpy(data, _storage.data() + _cursor, size);
+      _cursor += size;
+    }
+  }
+
+  //! Gets the data which were not read yet.
+  //! @returns View of the remaining data.
+  [[nodiscard]] Storage GetRemaining() const
+  {
+    return _storage.subspan(_cursor);
+  }
 
   //! Read a value from the source stream.
   //!
@@ -211,22 +287,45 @@ public:
     StreamReader<T>{}(value, *this);
     return *this;
   }
+
+private:
+  //! Throws the overflow error, kept out of line of the reads.
+  [[noreturn]] void ThrowOverflow(std::size_t size) const;
 };
 
 //! General binary reader.
 //! Reads a little-endian byte sequence from the provided source buffer.
+//! Types which are not trivially copyable require a specialization.
 //!
 //! @tparam T Type of value.
 template <typename T> struct StreamReader
 {
+  static_assert(
+    std::is_trivially_copyable_v<T>,
+    "The general stream reader requires a trivially copyable type");
+
   void operator()(T& value, SourceStream& buffer)
   {
-    const auto byteCount = sizeof(value);
-    buffer.Read(reinterpret_cast<void*>(&value), byteCount);
+    buffer.Read(&value, sizeof(value));
+
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>)
+    {
+      value = ToLittleEndian(value);
+    }
+    else
+    {
+      // Compound types are read as they are laid out in memory.
+      static_assert(
+        std::endian::native == std::endian::little || sizeof(T) == 1,
+        "Compound types require a reader specialization on big-endian hosts");
+    }
   }
 };
 
 DECLARE_WRITER_READER(std::string)
+//! The read view borrows from the underlying storage of the source stream
+//! and is valid only for as long as that storage.
+DECLARE_WRITER_READER(std::string_view)
 
 //! Performs deferred call on destruction.
 struct Deferred final
@@ -0,0 +1,90 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef IO_CONTEXT_POOL_HPP
+#define IO_CONTEXT_POOL_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace alicia
+{
+
+namespace asio = boost::asio;
+
+//! Pool of I/O contexts, each of which is run by its own thread.
+//! Servers hosted on the pool share the I/O threads, and their clients
+//! are distributed across the contexts.
+class IoContextPool
+{
+public:
+  //! Default constructor.
+  //! @param threadCount Number of I/O threads.
+  //!                    Zero selects the number of hardware threads.
+  explicit IoContextPool(std::size_t threadCount = 0);
+
+  //! Deleted copy constructor.
+  IoContextPool(const IoContextPool&) = delete;
+  //! Deleted copy assignment.
+  IoContextPool& operator=(const IoContextPool&) = delete;
+
+  //! Runs the I/O threads of the pool.
+  //! Blocks until the pool is stopped.
+  void Run();
+
+  //! Stops the I/O contexts of the pool.
+  void Stop();
+
+  //! Get the next I/O context in the round-robin order.
+  //! @returns I/O context.
+  [[nodiscard]] asio::io_context& GetContext();
+
+  //! Get the I/O context at the specified index.
+  //! @param index Index of the I/O context.
+  //! @returns I/O context.
+  [[nodiscard]] asio::io_context& GetContext(std::size_t index);
+
+  //! Get the number of I/O contexts in the pool.
+  //! @returns Number of I/O contexts.
+  [[nodiscard]] std::size_t GetSize() const;
+
+  //! Get the name of the I/O backend the contexts were built with.
+  //! @returns Name of the I/O backend.
+  [[nodiscard]] static const char* GetBackendName();
+
+private:
+  //! Work guard of an I/O context.
+  using WorkGuard = asio::executor_work_guard<asio::io_context::executor_type>;
+
+  //! I/O contexts.
+  std::vector<std::unique_ptr<asio::io_context>> _contexts;
+  //! Work guards keeping the I/O contexts running when idle.
+  std::vector<WorkGuard> _workGuards;
+
+  //! Index of the next I/O context.
+  std::atomic<std::size_t> _nextContext = 0;
+};
+
+} // namespace alicia
+
+#endif //IO_CONTEXT_POOL_HPP
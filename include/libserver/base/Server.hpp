@@ -20,10 +20,17 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "IoContextPool.hpp"
+#include "TimingWheel.hpp"
+
+#include <atomic>
+#include <chrono>
 #include <cstdint>
-#include <unordered_map>
 #include <functional>
-#include <queue>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
 
 #include <boost/asio.hpp>
 
@@ -33,54 +40,156 @@ namespace alicia
 namespace asio = boost::asio;
 
 //! Client Id.
+//! The low half is the index of the client slot, the high half is the generation
+//! of the slot, so the ID of a disconnected client never matches a reused slot.
 using ClientId = std::size_t;
 
-//! A write handler.
-using WriteSupplier = std::function<void(asio::streambuf&)>;
+//! An immutable buffer with the data of a write.
+//! The same buffer may be queued to several clients without being copied.
+using WriteBuffer = std::shared_ptr<const std::vector<std::byte>>;
+
+//! Key of a supersedable write.
+//! While the client is congested, a write replaces the queued write with the same key,
+//! or is queued if there's none. Zero is the key of the reliable writes, which are always queued.
+using WriteKey = std::uint64_t;
+
+//! Limits of the data queued to be written to a client.
+struct ClientWriteLimits
+{
+  //! Number of the queued bytes above which the client is congested,
+  //! and its supersedable writes replace their stale queued writes. Zero disables the limits.
+  std::size_t highWatermark = 0;
+  //! Number of the queued bytes below which the congested client recovers.
+  std::size_t lowWatermark = 0;
+  //! Number of the queued bytes above which the client is ended.
+  //! Zero disables the limit.
+  std::size_t maxQueuedSize = 0;
+};
 
 //! Client with event driven reads and writes
 //! to the underlying socket connection.
+//!
+//! The client is reused for the following connections once it's reclaimed,
+//! keeping its buffers and handlers.
 class Client
 {
 public:
   //! Client IO begin handler.
-  using BeginHandler = std::function<void()>;
+  using BeginHandler = std::function<void(ClientId)>;
   //! Client IO end handler.
-  using EndHandler = std::function<void()>;
+  using EndHandler = std::function<void(ClientId)>;
 
-  //! Client write handler.
-  using WriteHandler = std::function<void(asio::streambuf&)>;
   //! Client read handler.
-  using ReadHandler = std::function<void(asio::streambuf&)>;
+  //! Receives the buffered bytes which were not consumed yet, which it may modify in place,
+  //! and returns the number of bytes it consumed from the front of them.
+  using ReadHandler = std::function<std::size_t(ClientId, std::span<std::byte>)>;
+
+  //! Client reclaim handler.
+  //! Invoked on the executor of the client once the client ended
+  //! and has no I/O in flight, after which the client may be reset.
+  using ReclaimHandler = std::function<void(ClientId)>;
+
+  //! Client congestion handler.
+  //! Invoked on the executor of the client when its queued writes exceed
+  //! the high watermark, and when they drain below the low watermark.
+  using CongestionHandler = std::function<void(ClientId, bool congested)>;
 
   //! Default constructor.
-  //! @param socket Underlying socket.
+  //! @param socket Underlying socket,
+  //!               its executor serializes the I/O of the client.
+  //! @param clientId ID of the client.
+  //! @param writeLimits Limits of the queued writes, must outlive the client.
   explicit Client(
     asio::ip::tcp::socket&& socket,
+    ClientId clientId,
+    const ClientWriteLimits& writeLimits,
     BeginHandler beginHandler,
     EndHandler endHandler,
     ReadHandler readHandler,
-    WriteHandler writeHandler) noexcept;
+    ReclaimHandler reclaimHandler,
+    CongestionHandler congestionHandler) noexcept;
+
+  //! Resets the reclaimed client for a new connection.
+  //! @param socket Underlying socket of the new connection.
+  //! @param clientId ID of the client.
+  void Reset(asio::ip::tcp::socket&& socket, ClientId clientId) noexcept;
 
   //!
   void Begin();
   //!
   void End();
 
+  //! Queues the end of the client.
+  //! Safe to call from any thread, the client is ended on its executor.
+  //! The end is dropped if the client is reset before it's performed.
+  void QueueEnd();
+
   //! Queues a write.
-  void QueueWrite(WriteSupplier writeSupplier);
+  //! Safe to call from any thread, the write is performed on the executor of the client.
+  //! All the writes queued before the write loop runs are sent with a single gather write.
+  //! The write is dropped if the client is reset before it's performed.
+  //! @param buffer Buffer to write.
+  //! @param key Key of a supersedable write, zero for a reliable write.
+  void QueueWrite(WriteBuffer buffer, WriteKey key = 0);
+
+  //! Get the ID of the client.
+  //! @returns ID of the client.
+  [[nodiscard]] ClientId GetId() const;
 
 private:
   //! Read loop.
   void ReadLoop() noexcept;
+  //! Write loop.
+  void WriteLoop() noexcept;
+  //! Invokes the reclaim handler, once the client ended and has no I/O in flight.
+  void TryReclaim() noexcept;
+
+  //! An ID of the client, changed when the client is reset.
+  std::atomic<ClientId> _clientId;
 
   //! Indicates whether the client should process I/O.
   std::atomic<bool> _processIo = false;
+  //! Indicates whether the client was reclaimed.
+  //! Only accessed on the executor of the client.
+  bool _isReclaimed = false;
+
+  //! A contiguous read buffer, reused for the lifetime of the client.
+  std::vector<std::byte> _readBuffer;
+  //! Offset of the first unconsumed byte in the read buffer.
+  std::size_t _readHead = 0;
+  //! Offset past the last received byte in the read buffer.
+  std::size_t _readTail = 0;
+  //! Indicates whether a read is in progress.
+  //! Only accessed on the executor of the client.
+  bool _isReading = false;
 
-  //! A read buffer.
-  asio::streambuf _readBuffer{};
-  //! A write buffer.
-  asio::streambuf _writeBuffer{};
+  //! A write queued to be sent.
+  struct QueuedWrite
+  {
+    //! A buffer to write.
+    WriteBuffer buffer;
+    //! A key of the write, zero if the write is reliable.
+    WriteKey key = 0;
+  };
+
+  //! Limits of the queued writes.
+  const ClientWriteLimits& _writeLimits;
+  //! Writes queued to be written.
+  std::vector<QueuedWrite> _writeQueue{};
+  //! Buffers being written.
+  std::vector<WriteBuffer> _writesInFlight{};
+  //! Gather sequence of the buffers being written.
+  std::vector<asio::const_buffer> _writeSequence{};
+  //! Indicates whether the write loop is scheduled or in progress.
+  //! Only accessed on the executor of the client.
+  bool _isWriting = false;
+  //! Number of the bytes queued and being written.
+  //! Only accessed on the executor of the client.
+  std::size_t _queuedSize = 0;
+  //! Indicates whether the queued writes exceeded the high watermark
+  //! and haven't drained below the low watermark yet.
+  //! Only accessed on the executor of the client.
+  bool _isCongested = false;
 
   //! A begin handler.
   BeginHandler _beginHandler;
@@ -88,21 +197,40 @@ private:
   EndHandler _endHandler;
   //! A read handler.
   ReadHandler _readHandler;
-  //! A write handler.
-  WriteHandler _writeHandler;
+  //! A reclaim handler.
+  ReclaimHandler _reclaimHandler;
+  //! A congestion handler.
+  CongestionHandler _congestionHandler;
 
   //! A client socket.
   asio::ip::tcp::socket _socket;
 };
 
+//! Timeouts of the clients of a server.
+struct ClientTimeouts
+{
+  //! Time in which a connected client must send its first data.
+  //! Zero disables the timeout.
+  std::chrono::milliseconds handshake{0};
+  //! Time in which a client must send data after its last data,
+  //! the heartbeats of the client keep it alive. Zero disables the timeout.
+  std::chrono::milliseconds idle{0};
+  //! Time in which a congested client must drain its writes below the low watermark.
+  //! Zero disables the timeout.
+  std::chrono::milliseconds stall{0};
+};
+
 //! Server with event-driven acceptor, reads and writes.
+//!
+//! The clients are kept in a pool of slots. The slot of a disconnected client
+//! is recycled once the client has no I/O in flight, and its generation
+//! is incremented so the stale client IDs don't refer to the new client.
 class Server
 {
 public:
-  //! Client write handler.
-  using ClientWriteHandler = std::function<void(ClientId, asio::streambuf&)>;
   //! Client read handler.
-  using ClientReadHandler = std::function<void(ClientId, asio::streambuf&)>;
+  //! Returns the number of the bytes consumed.
+  using ClientReadHandler = std::function<std::size_t(ClientId, std::span<std::byte>)>;
 
   //! Client connect handler.
   using ClientConnectHandler = std::function<void(ClientId)>;
@@ -110,25 +238,89 @@ public:
   using ClientDisconnectHandler = std::function<void(ClientId)>;
 
   //! Default constructor.
+  //! @param ioContextPool Pool of I/O contexts the server and its clients run on.
   explicit Server(
+    IoContextPool& ioContextPool,
     ClientConnectHandler clientConnectHandler,
     ClientDisconnectHandler clientDisconnectHandler,
-    ClientReadHandler clientReadHandler,
-    ClientWriteHandler clientWriteHandler) noexcept;
+    ClientReadHandler clientReadHandler) noexcept;
 
   //! Hosts the server.
+  //! Does not block, the I/O is processed by the threads of the I/O context pool.
   //!
   //! @param interface Address of the interface to bind to.
   //! @param port Port to bind to.
+  //! @param reusePort Whether each I/O context accepts the clients with its own
+  //!                  SO_REUSEPORT acceptor, the kernel balancing the connections
+  //!                  between them. The accepted clients stay on the accepting context.
+  //!                  Otherwise a single acceptor distributes the clients round-robin.
   void Host(
     const asio::ip::address& address,
-    uint16_t port);
+    uint16_t port,
+    bool reusePort = false);
+
+  //! Enables the timeouts of the clients, tracked by the timing wheel.
+  //! Must be called before the server is hosted.
+  //! @param timingWheel Timing wheel tracking the deadlines of the clients.
+  //! @param timeouts Timeouts of the clients.
+  void EnableTimeouts(TimingWheel& timingWheel, ClientTimeouts timeouts);
+
+  //! Enables the limits of the data queued to the clients.
+  //! Must be called before the server is hosted.
+  //! @param writeLimits Limits of the queued writes.
+  void EnableWriteLimits(ClientWriteLimits writeLimits);
 
-  //! Get client.
-  Client& GetClient(ClientId clientId);
+  //! Queues a write to the client.
+  //! The write is dropped if the client is no longer connected.
+  //! @param clientId ID of the client.
+  //! @param buffer Buffer to write.
+  //! @param key Key of a supersedable write, zero for a reliable write.
+  void QueueWrite(ClientId clientId, WriteBuffer buffer, WriteKey key = 0);
 
 private:
-  void AcceptLoop() noexcept;
+  //! Acceptor of the clients.
+  struct Acceptor
+  {
+    //! A socket acceptor.
+    asio::ip::tcp::acceptor acceptor;
+    //! A context the accepted clients run on,
+    //! or null to distribute the clients across the pool.
+    asio::io_context* clientContext = nullptr;
+  };
+
+  //! Opens the acceptor bound to the endpoint.
+  //! @param context Context the acceptor runs on.
+  //! @param endpoint Endpoint to bind to.
+  //! @param reusePort Whether to enable SO_REUSEPORT on the acceptor.
+  //! @returns Listening acceptor.
+  static asio::ip::tcp::acceptor OpenAcceptor(
+    asio::io_context& context,
+    const asio::ip::tcp::endpoint& endpoint,
+    bool reusePort);
+
+  void AcceptLoop(Acceptor& acceptor) noexcept;
+
+  //! Returns the slot of the client to the pool.
+  //! @param clientId ID of the reclaimed client.
+  void ReclaimClient(ClientId clientId);
+
+  //! Schedules the deadline of the client, if the timeouts are enabled.
+  //! @param clientId ID of the client.
+  //! @param timeout Timeout of the client, zero cancels its deadline.
+  void ScheduleTimeout(ClientId clientId, std::chrono::milliseconds timeout);
+  //! Schedules or cancels the stall deadline of the congested client.
+  //! @param clientId ID of the client.
+  //! @param congested Whether the client is congested.
+  void HandleCongestion(ClientId clientId, bool congested);
+  //! Ends the clients whose read deadlines expired.
+  //! @param clientIds IDs of the timed out clients.
+  void HandleTimeouts(std::span<const ClientId> clientIds);
+  //! Ends the clients whose queued writes stalled.
+  //! @param clientIds IDs of the stalled clients.
+  void HandleStalls(std::span<const ClientId> clientIds);
+  //! Ends the clients.
+  //! @param clientIds IDs of the clients.
+  void EndClients(std::span<const ClientId> clientIds);
 
   //! A client connect handler.
   ClientConnectHandler _clientConnectHandler;
@@ -136,16 +328,29 @@ private:
   ClientDisconnectHandler _clientDisconnectHandler;
   //! A client read handler.
   ClientReadHandler _clientReadHandler;
-  //! A client write handler.
-  ClientWriteHandler _clientWriteHandler;
 
-  asio::io_context _io_ctx;
-  asio::ip::tcp::acceptor _acceptor;
+  //! A pool of I/O contexts.
+  IoContextPool& _ioContextPool;
+  //! Acceptors of the clients.
+  std::vector<std::unique_ptr<Acceptor>> _acceptors;
+
+  //! A timing wheel tracking the deadlines of the clients, if the timeouts are enabled.
+  TimingWheel* _timingWheel = nullptr;
+  //! A listener of the timing wheel.
+  TimingWheel::ListenerId _timeoutListenerId{};
+  //! A listener of the timing wheel tracking the congested clients.
+  TimingWheel::ListenerId _stallListenerId{};
+  //! Timeouts of the clients.
+  ClientTimeouts _timeouts;
+  //! Limits of the queued writes of the clients.
+  ClientWriteLimits _writeLimits;
 
-  //! Sequential client ID.
-  ClientId _client_id = 0;
-  //! Map of clients.
-  std::unordered_map<ClientId, Client> _clients;
+  //! Mutex guarding the client slots.
+  std::mutex _clientsMutex;
+  //! Client slots, the clients are never destroyed while the server lives.
+  std::vector<std::unique_ptr<Client>> _clients;
+  //! Indices of the free client slots.
+  std::vector<std::size_t> _freeClientSlots;
 };
 
 } // namespace alicia
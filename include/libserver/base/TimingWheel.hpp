@@ -0,0 +1,182 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+namespace alicia
+{
+
+namespace asio = boost::asio;
+
+//! Hierarchical timing wheel tracking the deadlines of the clients.
+//!
+//! The deadlines are kept in the slots of the wheels of increasing granularity,
+//! so scheduling, extending and cancelling a deadline is O(1),
+//! and a single timer of the I/O context drives all the deadlines.
+//! The expired deadlines are reported in bulk, once per tick of each listener.
+class TimingWheel
+{
+public:
+  //! ID of a listener, a user of the wheel with its own deadlines.
+  using ListenerId = std::size_t;
+  //! ID of a tracked client, unique within its listener.
+  using ClientId = std::size_t;
+
+  //! Handler of the expired deadlines.
+  //! Receives the clients whose deadlines expired during the tick.
+  using ExpiryHandler = std::function<void(std::span<const ClientId>)>;
+
+  //! Default constructor.
+  //! @param ioContext I/O context the timer of the wheel runs on.
+  //! @param tickInterval Interval of the tick, the resolution of the deadlines.
+  explicit TimingWheel(
+    asio::io_context& ioContext,
+    std::chrono::milliseconds tickInterval);
+
+  //! Deleted copy constructor.
+  TimingWheel(const TimingWheel&) = delete;
+  //! Deleted copy assignment.
+  TimingWheel& operator=(const TimingWheel&) = delete;
+
+  //! Adds a listener of the expired deadlines.
+  //! Must be called before the wheel is started.
+  //! @param handler Handler of the expired deadlines.
+  //! @returns ID of the listener.
+  [[nodiscard]] ListenerId AddListener(ExpiryHandler handler);
+
+  //! Starts ticking the wheel on the timer of the I/O context.
+  void Start();
+  //! Stops ticking the wheel.
+  void Stop();
+
+  //! Schedules the deadline of the client, replacing its current deadline.
+  //! Safe to call from any thread.
+  //! @param listenerId ID of the listener.
+  //! @param clientId ID of the client.
+  //! @param timeout Time from now until the deadline.
+  void Schedule(
+    ListenerId listenerId,
+    ClientId clientId,
+    std::chrono::milliseconds timeout);
+
+  //! Cancels the deadline of the client.
+  //! Safe to call from any thread.
+  //! @param listenerId ID of the listener.
+  //! @param clientId ID of the client.
+  void Cancel(ListenerId listenerId, ClientId clientId);
+
+  //! Advances the wheel by one tick, invoking the listeners of the expired deadlines.
+  //! Called by the timer of the wheel, must not be called concurrently.
+  void Tick();
+
+private:
+  //! Number of the bits of the slot index of a wheel.
+  static constexpr std::size_t SlotBits = 6;
+  //! Number of the slots of a wheel.
+  static constexpr std::size_t SlotCount = std::size_t{1} << SlotBits;
+  //! Number of the wheels, each covering the range of the previous one in a slot.
+  static constexpr std::size_t WheelCount = 4;
+  //! Maximal number of the ticks between a deadline and the current tick
+  //! the wheels can hold. Farther deadlines are relinked when they're reached.
+  static constexpr uint64_t MaxDeadlineDistance = (uint64_t{1} << (SlotBits * WheelCount)) - 1;
+  //! Index of no entry.
+  static constexpr uint32_t NoEntry = UINT32_MAX;
+
+  //! Deadline of a client, linked in a slot of a wheel.
+  struct Entry
+  {
+    //! A listener of the deadline.
+    ListenerId listenerId{};
+    //! A client of the deadline.
+    ClientId clientId{};
+    //! A tick of the deadline.
+    uint64_t deadline{};
+    //! A wheel the entry is linked in.
+    uint32_t wheel{};
+    //! A slot the entry is linked in.
+    uint32_t slot{};
+    //! A previous entry in the slot.
+    uint32_t previous = NoEntry;
+    //! A next entry in the slot.
+    uint32_t next = NoEntry;
+  };
+
+  //! Listener of the expired deadlines.
+  struct Listener
+  {
+    //! A handler of the expired deadlines.
+    ExpiryHandler handler;
+    //! Entries of the clients of the listener.
+    std::unordered_map<ClientId, uint32_t> entries;
+    //! Clients whose deadlines expired during the tick.
+    std::vector<ClientId> expired;
+  };
+
+  //! Links the entry to the slot of its deadline.
+  void Link(uint32_t entryIndex);
+  //! Unlinks the entry from its slot.
+  void Unlink(uint32_t entryIndex);
+  //! Detaches the list of the entries of the slot.
+  //! @returns Index of the first entry of the list.
+  uint32_t Detach(std::size_t wheel, std::size_t slot);
+  //! Frees the entry.
+  void Free(uint32_t entryIndex);
+
+  //! Waits for the next tick of the timer.
+  void WaitTick();
+
+  //! Mutex guarding the entries and the slots.
+  std::mutex _mutex;
+  //! Entries of the deadlines.
+  std::vector<Entry> _entries;
+  //! Indices of the free entries.
+  std::vector<uint32_t> _freeEntries;
+  //! Heads of the slots of the wheels.
+  std::array<std::array<uint32_t, SlotCount>, WheelCount> _slots;
+  //! Listeners of the expired deadlines.
+  std::vector<Listener> _listeners;
+  //! Current tick of the wheel.
+  uint64_t _currentTick = 0;
+
+  //! An interval of the tick.
+  std::chrono::milliseconds _tickInterval;
+  //! A time of the next tick.
+  std::chrono::steady_clock::time_point _nextTickTime;
+  //! A timer of the ticks.
+  asio::steady_timer _timer;
+  //! Indicates whether the wheel is ticking.
+  std::atomic<bool> _isTicking = false;
+};
+
+} // namespace alicia
+
+#endif // TIMING_WHEEL_HPP
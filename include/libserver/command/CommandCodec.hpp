@@ -0,0 +1,47 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef COMMAND_CODEC_HPP
+#define COMMAND_CODEC_HPP
+
+#include "CommandProtocol.hpp"
+
+#include <span>
+
+namespace alicia
+{
+
+//! Decodes the scrambled command data in place.
+//! Every byte of the data is XORed with the byte of the 4-byte rolling key
+//! at the position of the byte modulo 4.
+//!
+//! @param data Command data.
+//! @param key XOR key.
+void DecodeCommandData(std::span<std::byte> data, const XorCode& key);
+
+//! Encodes the command data in place.
+//! The XOR scrambler is its own inverse, encoding matches the decoding.
+//!
+//! @param data Command data.
+//! @param key XOR key.
+void EncodeCommandData(std::span<std::byte> data, const XorCode& key);
+
+} // namespace alicia
+
+#endif //COMMAND_CODEC_HPP
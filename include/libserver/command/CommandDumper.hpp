@@ -0,0 +1,152 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef COMMAND_DUMPER_HPP
+#define COMMAND_DUMPER_HPP
+
+#include "CommandProtocol.hpp"
+#include "libserver/base/Server.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+
+#include <spdlog/spdlog.h>
+
+namespace alicia
+{
+
+//! Dumps the data of the commands to the debug log.
+//! The dumps are formatted and logged by a background thread,
+//! the threads handling the commands only queue the data.
+class CommandDumper
+{
+public:
+  //! Direction of the dumped command.
+  enum class Direction
+  {
+    Received,
+    Sent
+  };
+
+  //! Default constructor.
+  //! The commands which are not muted are dumped by default.
+  //! @param name Name of the dumper.
+  explicit CommandDumper(std::string name);
+
+  //! Deleted copy constructor.
+  CommandDumper(const CommandDumper&) = delete;
+  //! Deleted copy assignment.
+  CommandDumper& operator=(const CommandDumper&) = delete;
+
+  //! Sets whether to dump the command.
+  //! @param command ID of the command.
+  //! @param dumped Whether to dump the command.
+  void SetCommandDumped(CommandId command, bool dumped);
+
+  //! Checks whether the command should be dumped.
+  //! Cheap enough to be checked for every command.
+  //! @param command ID of the command.
+  //! @returns `true` if the debug level is enabled and the command is dumped.
+  [[nodiscard]] bool IsDumped(CommandId command) const
+  {
+    if (!spdlog::should_log(spdlog::level::debug))
+    {
+      return false;
+    }
+
+    const auto id = static_cast<uint16_t>(command);
+    return (_commandFlags[id / 64].load(std::memory_order_relaxed) >> id % 64 & 1) != 0;
+  }
+
+  //! Queues the dump of the command data.
+  //! The data are copied.
+  //!
+  //! @param clientId ID of the client.
+  //! @param command ID of the command.
+  //! @param direction Direction of the command.
+  //! @param data Command data.
+  void Dump(
+    ClientId clientId,
+    CommandId command,
+    Direction direction,
+    std::span<const std::byte> data);
+
+  //! Queues the dump of the command data shared with a write.
+  //! The buffer is referenced, not copied.
+  //!
+  //! @param recipients IDs of the clients the command is sent to.
+  //! @param command ID of the command.
+  //! @param buffer Buffer with the serialized command.
+  //! @param offset Offset of the command data in the buffer.
+  void Dump(
+    std::span<const ClientId> recipients,
+    CommandId command,
+    WriteBuffer buffer,
+    std::size_t offset);
+
+private:
+  //! Queued dump.
+  struct Entry
+  {
+    //! A direction of the command.
+    Direction direction;
+    //! An ID of the command.
+    CommandId command;
+    //! An ID of the client the command was received from or sent to.
+    ClientId clientId;
+    //! A number of the clients the command was sent to.
+    std::size_t recipients;
+    //! A buffer with the command data.
+    WriteBuffer buffer;
+    //! An offset of the command data in the buffer.
+    std::size_t offset;
+  };
+
+  //! Queues the dump.
+  void Enqueue(Entry entry);
+  //! Formats and logs the queued dumps until stopped.
+  void Run(const std::stop_token& stopToken);
+
+  //! A name of the dumper.
+  std::string _name;
+  //! Bit flags of the dumped commands, indexed by the command ID.
+  std::array<std::atomic<uint64_t>, 1024> _commandFlags{};
+
+  //! Mutex guarding the queue.
+  std::mutex _queueMutex;
+  //! Condition signaled when a dump is queued.
+  std::condition_variable_any _queueCondition;
+  //! Queued dumps.
+  std::deque<Entry> _queue;
+  //! Number of the dumps dropped since the last report.
+  std::size_t _droppedDumps = 0;
+
+  //! A worker thread, declared last to be stopped first.
+  std::jthread _worker;
+};
+
+} // namespace alicia
+
+#endif //COMMAND_DUMPER_HPP
@@ -70,97 +70,164 @@ MessageMagic decode_message_magic(uint32_t value);
 //! @return Encoded message magic value.
 uint32_t encode_message_magic(MessageMagic magic);
 
-//! IDs of the commands in the protocol.
-enum class CommandId
-  : uint16_t
-{
-  LobbyLogin = 0x0007,
-  LobbyLoginOK = 0x0008,
-  LobbyLoginCancel = 0x0009,
-
-  LobbyHeartbeat = 0x12,
-
-  LobbyShowInventory = 0x007e,
-  LobbyShowInventoryOK = 0x007f,
-  LobbyShowInventoryCancel = 0x0080,
-
-  LobbyAchievementCompleteList = 0x00e5,
-  LobbyAchievementCompleteListOK = 0x00e6,
-  LobbyAchievementCompleteListCancel = 0x00e7,
-
-  LobbyRequestDailyQuestList = 0x0356,
-  LobbyRequestDailyQuestListOK = 0x0357,
-  // ToDo: Not sure about the cancel response being available.
-  LobbyRequestDailyQuestListCancel = 0x0358,
-
-  LobbyRequestLeagueInfo = 0x0376,
-  LobbyRequestLeagueInfoOK = 0x0377,
-  LobbyRequestLeagueInfoCancel = 0x0378,
-
-  LobbyRequestQuestList = 0x03f8,
-  LobbyRequestQuestListOK = 0x03f9,
-  LobbyRequestQuestListCancel = 0x03fa,
+//! Max size of the command data.
+constexpr std::size_t MaxCommandDataSize = BufferSize - sizeof(uint32_t);
 
-  LobbyRequestSpecialEventList = 0x417,
-  LobbyRequestSpecialEventListOK = 0x418,
+//! Max size of the padding of the encoded command data.
+constexpr std::size_t MaxCommandPaddingSize = 7;
 
-  LobbyEnterRanch = 0xfc,
-  LobbyEnterRanchOK = 0xfd,
-  LobbyEnterRanchCancel = 0xfe,
+//! Max size of a string in the command data, including its terminator.
+constexpr std::size_t MaxCommandStringSize = 256;
 
-  LobbyGetMessengerInfo = 0x186,
-  LobbyGetMessengerInfoOK = 0x187,
-  LobbyGetMessengerInfoCancel = 0x188,
-
-  LobbyClientNotify = 0x309,
-
-  RanchEnterRanch = 0x12b,
-  RanchEnterRanchCancel = 0x12d,
-  RanchEnterRanchNotify = 0x12e,
-  RanchEnterRanchOK = 0x12c,
-
-  RanchHeartbeat = 0x9e,
-
-  RanchSnapshot = 0x139,
-  RanchSnapshotNotify = 0x13a,
-
-  RanchCmdAction = 0x1c9,
-  RanchCmdActionNotify = 0x1ca,
-
-  RanchStuff = 0x1af,
-  RanchStuffOK = 0x1b0,
-
-  RanchUpdateBusyState = 0x1a8,
-  RanchUpdateBusyStateNotify = 0x1a9,
-
-  RanchSearchStallion = 0x145,
-  RanchSearchStallionOK = 0x146,
-  RanchSearchStallionCancel = 0x147,
+//! Get the max size of the encoded command data.
+//! @param size Max size of the fields of the command.
+//! @returns Max size of the command data including the padding.
+constexpr std::size_t MaxEncodedSize(std::size_t size)
+{
+  return size + MaxCommandPaddingSize;
+}
+
+//! Definitions of the commands in the protocol, from which
+//! the command IDs and the command registry are generated.
+//! Every definition is X(name, id, direction, delivery, muted, max data size).
+//! The commands received by the server are bound by the size of their fields,
+//! the commands with data of an unknown structure are only bound by the frame size.
+//! ToDo: Not sure about the LobbyRequestDailyQuestListCancel response being available.
+#define COMMAND_DEFINITIONS(X) \
+  X(LobbyLogin, 0x0007, ClientToServer, Reliable, false, MaxEncodedSize(9 + 2 * MaxCommandStringSize))            \
+  X(LobbyLoginOK, 0x0008, ServerToClient, Reliable, false, MaxCommandDataSize)                                    \
+  X(LobbyLoginCancel, 0x0009, ServerToClient, Reliable, false, MaxCommandDataSize)                                \
+  X(LobbyHeartbeat, 0x0012, ClientToServer, Reliable, true, MaxCommandDataSize)                                   \
+  X(LobbyShowInventory, 0x007e, ClientToServer, Reliable, false, MaxCommandDataSize)                              \
+  X(LobbyShowInventoryOK, 0x007f, ServerToClient, Reliable, false, MaxCommandDataSize)                            \
+  X(LobbyShowInventoryCancel, 0x0080, ServerToClient, Reliable, false, MaxCommandDataSize)                        \
+  X(LobbyAchievementCompleteList, 0x00e5, ClientToServer, Reliable, false, MaxEncodedSize(4))                     \
+  X(LobbyAchievementCompleteListOK, 0x00e6, ServerToClient, Reliable, false, MaxCommandDataSize)                  \
+  X(LobbyAchievementCompleteListCancel, 0x00e7, ServerToClient, Reliable, false, MaxCommandDataSize)              \
+  X(LobbyRequestDailyQuestList, 0x0356, ClientToServer, Reliable, false, MaxCommandDataSize)                      \
+  X(LobbyRequestDailyQuestListOK, 0x0357, ServerToClient, Reliable, false, MaxCommandDataSize)                    \
+  X(LobbyRequestDailyQuestListCancel, 0x0358, ServerToClient, Reliable, false, MaxCommandDataSize)                \
+  X(LobbyRequestLeagueInfo, 0x0376, ClientToServer, Reliable, false, MaxCommandDataSize)                          \
+  X(LobbyRequestLeagueInfoOK, 0x0377, ServerToClient, Reliable, false, MaxCommandDataSize)                        \
+  X(LobbyRequestLeagueInfoCancel, 0x0378, ServerToClient, Reliable, false, MaxCommandDataSize)                    \
+  X(LobbyRequestQuestList, 0x03f8, ClientToServer, Reliable, false, MaxEncodedSize(4))                            \
+  X(LobbyRequestQuestListOK, 0x03f9, ServerToClient, Reliable, false, MaxCommandDataSize)                         \
+  X(LobbyRequestQuestListCancel, 0x03fa, ServerToClient, Reliable, false, MaxCommandDataSize)                     \
+  X(LobbyRequestSpecialEventList, 0x0417, ClientToServer, Reliable, false, MaxEncodedSize(4))                     \
+  X(LobbyRequestSpecialEventListOK, 0x0418, ServerToClient, Reliable, false, MaxCommandDataSize)                  \
+  X(LobbyEnterRanch, 0x00fc, ClientToServer, Reliable, false, MaxEncodedSize(5 + MaxCommandStringSize))           \
+  X(LobbyEnterRanchOK, 0x00fd, ServerToClient, Reliable, false, MaxCommandDataSize)                               \
+  X(LobbyEnterRanchCancel, 0x00fe, ServerToClient, Reliable, false, MaxCommandDataSize)                           \
+  X(LobbyGetMessengerInfo, 0x0186, ClientToServer, Reliable, false, MaxCommandDataSize)                           \
+  X(LobbyGetMessengerInfoOK, 0x0187, ServerToClient, Reliable, false, MaxCommandDataSize)                         \
+  X(LobbyGetMessengerInfoCancel, 0x0188, ServerToClient, Reliable, false, MaxCommandDataSize)                     \
+  X(LobbyClientNotify, 0x0309, ServerToClient, Reliable, false, MaxCommandDataSize)                               \
+  X(RanchEnterRanch, 0x012b, ClientToServer, Reliable, false, MaxEncodedSize(12))                                 \
+  X(RanchEnterRanchCancel, 0x012d, ServerToClient, Reliable, false, MaxCommandDataSize)                           \
+  X(RanchEnterRanchNotify, 0x012e, ServerToClient, Reliable, false, MaxCommandDataSize)                           \
+  X(RanchEnterRanchOK, 0x012c, ServerToClient, Reliable, false, MaxCommandDataSize)                               \
+  X(RanchHeartbeat, 0x009e, ClientToServer, Reliable, true, MaxCommandDataSize)                                   \
+  X(RanchSnapshot, 0x0139, ClientToServer, Reliable, true, MaxCommandDataSize)                                    \
+  X(RanchSnapshotNotify, 0x013a, ServerToClient, Supersedable, true, MaxCommandDataSize)                          \
+  X(RanchCmdAction, 0x01c9, ClientToServer, Reliable, false, MaxCommandDataSize)                                  \
+  X(RanchCmdActionNotify, 0x01ca, ServerToClient, Reliable, false, MaxCommandDataSize)                            \
+  X(RanchStuff, 0x01af, ClientToServer, Reliable, false, MaxEncodedSize(8))                                       \
+  X(RanchStuffOK, 0x01b0, ServerToClient, Reliable, false, MaxCommandDataSize)                                    \
+  X(RanchUpdateBusyState, 0x01a8, ClientToServer, Reliable, false, MaxEncodedSize(1))                             \
+  X(RanchUpdateBusyStateNotify, 0x01a9, ServerToClient, Supersedable, false, MaxCommandDataSize)                  \
+  X(RanchSearchStallion, 0x0145, ClientToServer, Reliable, false, MaxEncodedSize(13 + 3 * (1 + 255 * 4)))         \
+  X(RanchSearchStallionOK, 0x0146, ServerToClient, Reliable, false, MaxCommandDataSize)                           \
+  X(RanchSearchStallionCancel, 0x0147, ServerToClient, Reliable, false, MaxCommandDataSize)                       \
+  X(RanchEnterBreedingMarket, 0x013f, ClientToServer, Reliable, false, MaxCommandDataSize)                        \
+  X(RanchEnterBreedingMarketOK, 0x0140, ServerToClient, Reliable, false, MaxCommandDataSize)                      \
+  X(RanchEnterBreedingMarketCancel, 0x0141, ServerToClient, Reliable, false, MaxCommandDataSize)                  \
+  X(RanchTryBreeding, 0x0156, ClientToServer, Reliable, false, MaxEncodedSize(8))                                 \
+  X(RanchTryBreedingOK, 0x0157, ServerToClient, Reliable, false, MaxCommandDataSize)                              \
+  X(RanchTryBreedingCancel, 0x0158, ServerToClient, Reliable, false, MaxCommandDataSize)                          \
+  X(RanchBreedingWishlist, 0x01e8, ClientToServer, Reliable, false, MaxCommandDataSize)                           \
+  X(RanchBreedingWishlistCancel, 0x01ea, ServerToClient, Reliable, false, MaxCommandDataSize)                     \
+  X(RanchBreedingWishlistOK, 0x01e9, ServerToClient, Reliable, false, MaxCommandDataSize)                         \
+  X(RanchUpdateMountNickname, 0x0197, ClientToServer, Reliable, false, MaxEncodedSize(8 + MaxCommandStringSize))  \
+  X(RanchUpdateMountNicknameOK, 0x0198, ServerToClient, Reliable, false, MaxCommandDataSize)                      \
+  X(RanchUpdateMountNicknameCancel, 0x0199, ServerToClient, Reliable, false, MaxCommandDataSize)
 
-  RanchEnterBreedingMarket = 0x13f,
-  RanchEnterBreedingMarketOK = 0x140,
-  RanchEnterBreedingMarketCancel = 0x141,
+//! IDs of the commands in the protocol.
+enum class CommandId
+  : uint16_t
+{
+#define COMMAND_ID(name, id, ...) name = id,
+  COMMAND_DEFINITIONS(COMMAND_ID)
+#undef COMMAND_ID
 
-  RanchTryBreeding = 0x156,
-  RanchTryBreedingOK = 0x157,
-  RanchTryBreedingCancel = 0x158,
+  Count = 0xFFFF
+};
 
-  RanchBreedingWishlist = 0x1e8,
-  RanchBreedingWishlistCancel = 0x1ea,
-  RanchBreedingWishlistOK = 0x1e9,
+//! Direction of a command.
+enum class CommandDirection
+  : uint8_t
+{
+  ClientToServer,
+  ServerToClient
+};
 
-  RanchUpdateMountNickname = 0x197,
-  RanchUpdateMountNicknameOK = 0x198,
-  RanchUpdateMountNicknameCancel = 0x199,
+//! Delivery of a command.
+enum class CommandDelivery
+  : uint8_t
+{
+  //! The command is always delivered.
+  Reliable,
+  //! The command may be replaced by a newer command of the same subject,
+  //! or dropped, while the client is not keeping up with its commands.
+  Supersedable
+};
 
-  Count = 0xFFFF
+//! Metadata of a command.
+struct CommandMeta
+{
+  //! A name of the command.
+  std::string_view name = "n/a";
+  //! A direction of the command.
+  CommandDirection direction = CommandDirection::ClientToServer;
+  //! A delivery of the command.
+  CommandDelivery delivery = CommandDelivery::Reliable;
+  //! Indicates whether the command is omitted from the debug logs.
+  bool muted = false;
+  //! Indicates whether the command is defined in the protocol.
+  bool defined = false;
+  //! A max size of the command data.
+  std::size_t maxDataSize = MaxCommandDataSize;
 };
 
+//! Get the metadata of the command from its ID.
+//! @param command ID of the command to retrieve the metadata for.
+//! @returns If command is defined, metadata of the command.
+//!          Otherwise, returns metadata with name "n/a".
+const CommandMeta& GetCommandMeta(CommandId command);
+
 //! Get the name of the command from its ID.
 //! @param command ID of the command to retrieve the name for.
 //! @returns If command is registered, name of the command.
 //!          Otherwise, returns "n/a".
-std::string_view GetCommandName(CommandId command);
+inline std::string_view GetCommandName(CommandId command)
+{
+  return GetCommandMeta(command).name;
+}
+
+//! Checks whether the command is omitted from the debug logs.
+//! @param command ID of the command.
+//! @returns `true` if the command is muted, `false` otherwise.
+inline bool IsCommandMuted(CommandId command)
+{
+  return GetCommandMeta(command).muted;
+}
+
+//! Checks whether the command may be superseded by a newer command of the same subject.
+//! @param command ID of the command.
+//! @returns `true` if the command is supersedable, `false` otherwise.
+inline bool IsCommandSupersedable(CommandId command)
+{
+  return GetCommandMeta(command).delivery == CommandDelivery::Supersedable;
+}
 
 } // namespace alicia
 
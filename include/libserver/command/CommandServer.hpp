@@ -20,11 +20,17 @@
 #ifndef COMMAND_SERVER_HPP
 #define COMMAND_SERVER_HPP
 
+#include "CommandDumper.hpp"
 #include "CommandProtocol.hpp"
 #include "libserver/base/Server.hpp"
 
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <unordered_map>
-#include <queue>
 
 namespace alicia
 {
@@ -32,9 +38,25 @@ namespace alicia
 //! A command handler.
 using RawCommandHandler = std::function<void(ClientId, SourceStream&)>;
 
+//! Traits of a command handler member function.
+template <typename Handler> struct CommandHandlerTraits;
+
+//! Traits of a command handler member function.
+//! @tparam C Class of the handler.
+//! @tparam T Type of the command.
+template <typename C, typename T>
+struct CommandHandlerTraits<void (C::*)(ClientId, const T&)>
+{
+  using Class = C;
+  using Command = T;
+};
+
 //! A command supplier.
 using CommandSupplier = std::function<void(SinkStream&)>;
 
+//! A client disconnect handler.
+using ClientDisconnectHandler = std::function<void(ClientId)>;
+
 //! A command client.
 class CommandClient
 {
@@ -45,9 +67,15 @@ public:
   [[nodiscard]] const XorCode& GetRollingCode() const;
   [[nodiscard]] int32_t GetRollingCodeInt() const;
 
+  //! Sets whether to dump the commands of the client.
+  void SetDumped(bool dumped);
+  //! Checks whether to dump the commands of the client.
+  [[nodiscard]] bool IsDumped() const;
+
 private:
-  std::queue<CommandSupplier> _commandQueue;
   XorCode _rollingCode{};
+  //! Indicates whether to dump the commands of the client.
+  std::atomic<bool> _dumped = true;
 };
 
 //! A command server.
@@ -55,13 +83,27 @@ class CommandServer
 {
 public:
   //! Default constructor;
-  CommandServer(std::string name);
+  //! @param name Name of the server.
+  //! @param ioContextPool Pool of I/O contexts the server runs on.
+  CommandServer(std::string name, IoContextPool& ioContextPool);
 
   //! Hosts the command server on the specified interface with the provided port.
-  //! Runs the processing loop and blocks until exception or stopped.
+  //! Does not block, the commands are processed by the threads of the I/O context pool.
   //! @param interface Interface address.
   //! @param port Port.
-  void Host(const asio::ip::address& address, uint16_t port);
+  //! @param reusePort Whether each I/O thread accepts the clients with its own SO_REUSEPORT acceptor.
+  void Host(const asio::ip::address& address, uint16_t port, bool reusePort = false);
+
+  //! Enables the timeouts of the clients, tracked by the timing wheel.
+  //! Must be called before the server is hosted.
+  //! @param timingWheel Timing wheel tracking the deadlines of the clients.
+  //! @param timeouts Timeouts of the clients.
+  void EnableTimeouts(TimingWheel& timingWheel, ClientTimeouts timeouts);
+
+  //! Enables the limits of the data queued to the clients.
+  //! Must be called before the server is hosted.
+  //! @param writeLimits Limits of the queued writes.
+  void EnableWriteLimits(ClientWriteLimits writeLimits);
 
   //! Registers a command handler.
   //!
@@ -90,33 +132,152 @@ public:
       });
   }
 
+  //! Registers a member function as a command handler.
+  //! The handler is bound at compile-time, reading the command
+  //! and invoking the handler is a single function without type erasure.
+  //!
+  //! @param commandId ID of the command to register the handler for.
+  //! @param instance Instance to invoke the handler on.
+  //! @tparam Handler Handler member function.
+  template<auto Handler>
+  void RegisterCommandHandler(
+    CommandId commandId,
+    typename CommandHandlerTraits<decltype(Handler)>::Class* instance)
+  {
+    using Traits = CommandHandlerTraits<decltype(Handler)>;
+
+    SetCommandHandler(
+      commandId,
+      {
+        .function = [](void* context, ClientId clientId, SourceStream& source)
+        {
+          typename Traits::Command command;
+          Traits::Command::Read(command, source);
+          (static_cast<typename Traits::Class*>(context)->*Handler)(clientId, command);
+        },
+        .context = instance
+      });
+  }
+
+  //! Registers a handler invoked when a client disconnects.
+  //!
+  //! @param handler Handler function.
+  void RegisterDisconnectHandler(ClientDisconnectHandler handler);
+
   void SetCode(ClientId client, XorCode code);
 
+  //! Sets whether to dump the data of the command to the debug log.
+  //!
+  //! @param command ID of the command.
+  //! @param dumped Whether to dump the command.
+  void SetCommandDumped(CommandId command, bool dumped);
+
+  //! Sets whether to dump the data of the commands of the client to the debug log.
+  //!
+  //! @param client ID of the client.
+  //! @param dumped Whether to dump the commands of the client.
+  void SetClientDumped(ClientId client, bool dumped);
+
+  //! Queues a command to be sent to the client.
+  //! The supplier is invoked on the calling thread and the command
+  //! is sent with the other commands queued during the same event loop turn.
   //!
+  //! @param client ID of the client.
+  //! @param command ID of the command.
+  //! @param supplier Supplier of the command data.
+  //! @param subject Subject of a supersedable command, such as an entity.
+  //!                The command supersedes the queued command with the same subject.
   void QueueCommand(
     ClientId client,
     CommandId command,
-    CommandSupplier supplier);
+    CommandSupplier supplier,
+    uint32_t subject = 0);
+
+  //! Queues a command to be sent to several clients.
+  //! The command is serialized once and the same buffer is queued to all the clients.
+  //!
+  //! @param clients IDs of the clients.
+  //! @param command ID of the command.
+  //! @param supplier Supplier of the command data.
+  //! @param subject Subject of a supersedable command, such as an entity.
+  //!                The command supersedes the queued command with the same subject.
+  void BroadcastCommand(
+    std::span<const ClientId> clients,
+    CommandId command,
+    CommandSupplier supplier,
+    uint32_t subject = 0);
 
 private:
+  //! Entry of the command dispatch table.
+  struct CommandHandlerEntry
+  {
+    //! Handler function.
+    using Function = void (*)(void* context, ClientId clientId, SourceStream& source);
+
+    //! A handler function.
+    Function function = nullptr;
+    //! A context passed to the handler function.
+    void* context = nullptr;
+  };
+
+  //! Number of the entries in a page of the dispatch table.
+  static constexpr std::size_t HandlerPageSize = 256;
+  //! Page of the dispatch table.
+  using CommandHandlerPage = std::array<CommandHandlerEntry, HandlerPageSize>;
+
+  //! Sets the entry of the dispatch table for the command.
+  //! @param commandId ID of the command.
+  //! @param entry Dispatch table entry.
+  void SetCommandHandler(CommandId commandId, CommandHandlerEntry entry);
+  //! Finds the entry of the dispatch table for the command.
+  //! @param commandId ID of the command.
+  //! @returns Dispatch table entry, or null if there's no handler for the command.
+  [[nodiscard]] const CommandHandlerEntry* FindCommandHandler(CommandId commandId) const;
+
   //!
   void HandleClientConnect(ClientId clientId);
   //!
   void HandleClientDisconnect(ClientId clientId);
-  //!
-  void HandleClientRead(
+  //! Handles all the complete commands received from the client.
+  //! The command data are decoded in place, in the read buffer of the client.
+  //! @returns Number of the bytes consumed.
+  std::size_t HandleClientRead(
     ClientId clientId,
-    asio::streambuf& readBuffer);
-  //!
-  void HandleClientWrite(
+    std::span<std::byte> readBuffer);
+  //! Decodes the command data and invokes the handler of the command.
+  void HandleCommand(
     ClientId clientId,
-    asio::streambuf& writeBuffer);
+    CommandClient& client,
+    const MessageMagic& magic,
+    std::span<std::byte> commandData);
 
   std::string _name;
 
-  std::unordered_map<CommandId, RawCommandHandler> _handlers{};
+  //! Get the command client.
+  //! @param clientId ID of the client.
+  //! @returns Command client, or null if the client is not connected.
+  CommandClient* GetClient(ClientId clientId);
+  //! Get whether the command data of the client are dumped.
+  //! @param clientId ID of the client.
+  //! @returns Whether the client is dumped, false if it's not connected.
+  bool IsClientDumped(ClientId clientId);
+
+  //! Command dispatch table, indexed by the high and the low byte of the command ID.
+  //! Pages are allocated for the ranges of the registered commands only.
+  //! The handlers are registered before the server is hosted and the table is read-only afterwards.
+  std::array<std::unique_ptr<CommandHandlerPage>, HandlerPageSize> _handlerPages{};
+  //! Raw handlers bound to the dispatch table entries.
+  std::deque<RawCommandHandler> _rawHandlers{};
+  //! A client disconnect handler.
+  ClientDisconnectHandler _disconnectHandler{};
+
+  //! Mutex guarding the map of clients.
+  std::mutex _clientsMutex;
   std::unordered_map<ClientId, CommandClient> _clients{};
 
+  //! A dumper of the command data.
+  CommandDumper _dumper;
+
   Server _server;
 };
 
@@ -7,157 +7,570 @@
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <filesystem>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
-#include <libserver/command/proto/DataDefines.hpp>
+#include "server/Settings.hpp"
+#include "server/storage/DataJournal.hpp"
+#include "server/storage/DataStorage.hpp"
 
 namespace alicia
 {
 
-//! Unique datum identifier.
-using DatumUid = uint32_t;
-//! Invalid datum identifier.
-constexpr DatumUid InvalidDatumUid = 0;
-
-//! Datum consumer is a callback which provides access to a value,
-//! to which access is guaranteed while in the consumer function.
-template<typename T>
-using DatumConsumer = std::function<void(T value)>;
-
-//! User.
-struct User
-{
-  std::string _token;
-
-  DatumUid characterUid;
-
-  //! Character.
-  struct Character
-  {
-    std::string nickName;
-    Gender gender = Gender::Unspecified;
-    uint16_t level{};
-    int32_t carrots{};
-    AgeGroup ageGroup = AgeGroup::Kid;
-
-    std::string status;
-
-    std::vector<Item> characterEquipment;
-    std::vector<Item> horseEquipment;
-
-    DatumUid mountUid{};
-    DatumUid ranchUid{};
-
-    std::vector<DatumUid> horses{};
-  };
-
-  //! Mount.
-  struct Mount
-  {
-    uint32_t tid{};
-    std::string name;
-  };
-
-  //! Ranch
-  struct Ranch
-  {
-    std::string ranchName;
-  };
-};
-
+//! Data director provides synchronized access to the data of the users.
+//! The data are kept in sharded stores, each shard guarded by a reader-writer lock.
+//! Lookups never insert the data, and the references to the data are stable
+//! for the lifetime of the director.
+//!
+//! The data are loaded from the data storage on demand. The data accessed
+//! mutably are marked dirty and written behind to the storage by a background
+//! thread, in a single transaction per interval. The same thread periodically
+//! writes a snapshot of all the data, from which a restarted server warms up.
+//!
+//! When the journal is enabled, the modified data are also appended to the journal
+//! by another thread in group commits, which bounds the loss on a crash to the journal
+//! interval without a round-trip to the storage. The journal is replayed on start
+//! and compacted into the snapshot.
 class DataDirector
 {
 public:
-  //!
+  //! Datum is a value guarded by a reader-writer lock.
   template<typename Val>
   struct Datum
   {
+    //! A value of the datum.
     Val value;
-    std::mutex lock;
+    //! A lock guarding the value.
+    mutable std::shared_mutex lock;
   };
 
+  //! Datum access holds the lock of the datum for its lifetime.
+  //! Access to a const value holds a shared lock, other access holds an exclusive lock.
   template<typename Val>
-  struct DatumAccess
+  class DatumAccess
   {
-    //!
-    explicit DatumAccess(Datum<Val>& datum)
-      : _datum(datum)
-      , _accessLock(_datum.lock)
+  public:
+    //! A lock held by the access.
+    using Lock = std::conditional_t<
+      std::is_const_v<Val>,
+      std::shared_lock<std::shared_mutex>,
+      std::unique_lock<std::shared_mutex>>;
+
+    //! Default constructor.
+    //! @param value Value of the datum.
+    //! @param lock Lock of the datum.
+    DatumAccess(Val& value, std::shared_mutex& lock)
+      : _value(&value)
+      , _accessLock(lock)
     {
     }
 
     //! Deleted copy constructor.
-    DatumAccess(const DatumAccess&) noexcept = delete;
+    DatumAccess(const DatumAccess&) = delete;
+    //! Deleted copy assignment.
+    DatumAccess& operator=(const DatumAccess&) = delete;
+
     //! Move constructor.
-    DatumAccess(DatumAccess&& other) noexcept
-      : _datum(other._datum)
+    DatumAccess(DatumAccess&&) noexcept = default;
+    //! Move assignment.
+    DatumAccess& operator=(DatumAccess&&) noexcept = default;
+
+    [[nodiscard]] Val* operator->() const noexcept
     {
-      other._accessLock.unlock();
-      other._accessLock.release();
+      return _value;
+    }
+
+    [[nodiscard]] Val& operator*() const noexcept
+    {
+      return *_value;
+    }
+
+  private:
+    //! A value of the datum.
+    Val* _value;
+    //! A lock of the datum.
+    Lock _accessLock;
+  };
 
-      _accessLock = _datum.lock;
+  //! Datum batch access holds the shared locks of many data for its lifetime,
+  //! providing a consistent snapshot of their values.
+  template<typename Val>
+  class DatumBatchAccess
+  {
+  public:
+    //! Default constructor.
+    //! @param values Values of the data.
+    //! @param locks Locks of the data.
+    DatumBatchAccess(
+      std::vector<const Val*> values,
+      std::vector<std::shared_lock<std::shared_mutex>> locks)
+      : _values(std::move(values))
+      , _accessLocks(std::move(locks))
+    {
     }
 
-    ~DatumAccess()
+    //! Deleted copy constructor.
+    DatumBatchAccess(const DatumBatchAccess&) = delete;
+    //! Deleted copy assignment.
+    DatumBatchAccess& operator=(const DatumBatchAccess&) = delete;
+
+    //! Move constructor.
+    DatumBatchAccess(DatumBatchAccess&&) noexcept = default;
+    //! Move assignment.
+    DatumBatchAccess& operator=(DatumBatchAccess&&) noexcept = default;
+
+    //! @param index Index of the UID the batch was requested with.
+    //! @returns Value of the datum.
+    [[nodiscard]] const Val& operator[](std::size_t index) const noexcept
     {
-      _accessLock.unlock();
+      return *_values[index];
     }
 
-    [[nodiscard]] Val* operator->() const noexcept {
-      return &_datum.value;
+    //! @returns Number of the values.
+    [[nodiscard]] std::size_t GetSize() const noexcept
+    {
+      return _values.size();
     }
 
   private:
-    Datum<Val>& _datum;
-    std::unique_lock<std::mutex> _accessLock;
+    //! Values of the data, in the order of the requested UIDs.
+    std::vector<const Val*> _values;
+    //! Locks of the data.
+    std::vector<std::shared_lock<std::shared_mutex>> _accessLocks;
   };
 
-  DataDirector();
+  //! Default constructor.
+  //! @param storage Storage of the data.
+  //! @param settings Data settings.
+  explicit DataDirector(
+    DataStorage& storage,
+    Settings::DataSettings settings = {});
 
-  //!
+  //! Deleted copy constructor.
+  DataDirector(const DataDirector&) = delete;
+  //! Deleted copy assignment.
+  DataDirector& operator=(const DataDirector&) = delete;
+
+  //! Stores the data modified since the last flush in a single transaction.
+  //! The data are marked dirty again if the storage fails.
+  void Flush();
+
+  //! Appends the data modified since the last commit to the journal,
+  //! if the journal is enabled.
+  void CommitJournal();
+
+  //! Writes a snapshot of all the data loaded in the director.
+  //! Each datum is read under its shared lock, the snapshot as a whole
+  //! is not a point-in-time copy. The snapshot is stamped with the flush sequence
+  //! of the last stored batch, the data modified since are stored with the later flushes.
+  //! @param path Path of the snapshot.
+  //! @throws std::runtime_error if the snapshot could not be written.
+  void WriteSnapshot(const std::filesystem::path& path);
+
+  //! Provides shared access to the user.
+  //! @throws std::runtime_error if the user does not exist.
   void GetUser(
     const std::string& name,
-    DatumConsumer<User&> consumer);
-  //!
-  DatumAccess<User> GetUser(
+    DatumConsumer<const User&> consumer);
+  //! Provides shared access to the user.
+  //! @throws std::runtime_error if the user does not exist.
+  [[nodiscard]] DatumAccess<const User> GetUser(
+    const std::string& name);
+  //! Provides exclusive access to the user, marking it dirty.
+  //! @throws std::runtime_error if the user does not exist.
+  [[nodiscard]] DatumAccess<User> GetUserMutable(
     const std::string& name);
 
-  //!
+  //! Provides shared access to the character.
+  //! @throws std::runtime_error if the character does not exist.
   void GetCharacter(
     DatumUid characterUid,
-    DatumConsumer<User::Character&> consumer);
-  //!
-  DatumAccess<User::Character> GetCharacter(
+    DatumConsumer<const User::Character&> consumer);
+  //! Provides shared access to the character.
+  //! @throws std::runtime_error if the character does not exist.
+  [[nodiscard]] DatumAccess<const User::Character> GetCharacter(
+    DatumUid characterUid);
+  //! Provides exclusive access to the character, marking it dirty.
+  //! @throws std::runtime_error if the character does not exist.
+  [[nodiscard]] DatumAccess<User::Character> GetCharacterMutable(
     DatumUid characterUid);
 
-  //!
+  //! Provides shared access to many characters at once.
+  //! The characters must be accessed before the mounts when both are held.
+  //! @param characterUids UIDs of the characters, may contain duplicates.
+  //! @throws std::runtime_error if any of the characters does not exist.
+  [[nodiscard]] DatumBatchAccess<User::Character> GetCharacters(
+    std::span<const DatumUid> characterUids);
+
+  //! Provides shared access to the mount.
+  //! @throws std::runtime_error if the mount does not exist.
   void GetMount(
     DatumUid mountUid,
-    DatumConsumer<User::Mount&> consumer);
-  DatumAccess<User::Mount> GetMount(
+    DatumConsumer<const User::Mount&> consumer);
+  //! Provides shared access to the mount.
+  //! @throws std::runtime_error if the mount does not exist.
+  [[nodiscard]] DatumAccess<const User::Mount> GetMount(
     DatumUid mountUid);
+  //! Provides exclusive access to the mount, marking it dirty.
+  //! @throws std::runtime_error if the mount does not exist.
+  [[nodiscard]] DatumAccess<User::Mount> GetMountMutable(
+    DatumUid mountUid);
+
+  //! Provides shared access to many mounts at once.
+  //! @param mountUids UIDs of the mounts, may contain duplicates.
+  //! @throws std::runtime_error if any of the mounts does not exist.
+  [[nodiscard]] DatumBatchAccess<User::Mount> GetMounts(
+    std::span<const DatumUid> mountUids);
 
-  //!
+  //! Provides shared access to the ranch.
+  //! @throws std::runtime_error if the ranch does not exist.
   void GetRanch(
     DatumUid ranchUid,
-    DatumConsumer<User::Ranch&> consumer);
-  DatumAccess<User::Ranch> GetRanch(
+    DatumConsumer<const User::Ranch&> consumer);
+  //! Provides shared access to the ranch.
+  //! @throws std::runtime_error if the ranch does not exist.
+  [[nodiscard]] DatumAccess<const User::Ranch> GetRanch(
+    DatumUid ranchUid);
+  //! Provides exclusive access to the ranch, marking it dirty.
+  //! @throws std::runtime_error if the ranch does not exist.
+  [[nodiscard]] DatumAccess<User::Ranch> GetRanchMutable(
     DatumUid ranchUid);
 
 private:
-  //!
-  std::unordered_map<std::string, Datum<User>> _users;
-  //!
-  std::unordered_map<DatumUid, Datum<User::Character>> _characters;
-  //!
-  std::unordered_map<DatumUid, Datum<User::Mount>> _mounts;
-  //!
-  std::unordered_map<DatumUid, Datum<User::Ranch>> _ranches;
+  //! Target the dirty data are collected for.
+  enum class DirtyTarget : std::size_t
+  {
+    Storage,
+    Journal
+  };
+
+  //! Datum store split into shards, each guarded by its own reader-writer lock.
+  //! The lock of a shard guards only the map, the data are guarded by their own locks.
+  //! The data are never removed, so the references to them stay valid.
+  template<typename Key, typename Val>
+  class DatumStore
+  {
+  public:
+    //! Loader of the data missing in the store.
+    using Loader = std::function<std::optional<Val>(const Key& key)>;
+
+    //! Default constructor.
+    //! @param loader Loader of the data missing in the store.
+    explicit DatumStore(Loader loader)
+      : _loader(std::move(loader))
+    {
+    }
+
+    //! Finds the datum, loading it if it's not in the store.
+    //! @param key Key of the datum.
+    //! @returns Found datum.
+    //! @throws std::runtime_error if the datum does not exist.
+    Datum<Val>& Find(const Key& key)
+    {
+      {
+        auto& shard = GetShard(key);
+        std::shared_lock lock(shard.lock);
+
+        const auto datumIter = shard.data.find(key);
+        if (datumIter != shard.data.end())
+        {
+          return datumIter->second;
+        }
+      }
+
+      return Load(key);
+    }
+
+    //! Finds many data and locks them shared.
+    //! Each shard is locked once, and the data are locked in the ascending order
+    //! of their keys, so concurrent batches can't deadlock.
+    //! @param keys Keys of the data, may contain duplicates.
+    //! @returns Batch access to the data.
+    //! @throws std::runtime_error if any of the data does not exist.
+    DatumBatchAccess<Val> FindMany(std::span<const Key> keys)
+    {
+      std::vector<Datum<Val>*> data(keys.size());
+      std::vector<std::size_t> missingIndices;
+
+      // Group the keys by the shards to look up each shard under a single lock.
+      std::array<std::vector<std::size_t>, ShardCount> shardIndices;
+      for (std::size_t index = 0; index < keys.size(); ++index)
+      {
+        shardIndices[GetShardIndex(keys[index])].emplace_back(index);
+      }
+
+      for (std::size_t shardIndex = 0; shardIndex < ShardCount; ++shardIndex)
+      {
+        if (shardIndices[shardIndex].empty())
+        {
+          continue;
+        }
+
+        auto& shard = _shards[shardIndex];
+        std::shared_lock lock(shard.lock);
+        for (const std::size_t index : shardIndices[shardIndex])
+        {
+          const auto datumIter = shard.data.find(keys[index]);
+          if (datumIter == shard.data.end())
+          {
+            missingIndices.emplace_back(index);
+            continue;
+          }
+
+          data[index] = &datumIter->second;
+        }
+      }
+
+      for (const std::size_t index : missingIndices)
+      {
+        data[index] = &Load(keys[index]);
+      }
+
+      // Lock each distinct datum once, in the order of the keys.
+      std::vector<std::size_t> lockOrder(keys.size());
+      std::iota(lockOrder.begin(), lockOrder.end(), 0);
+      std::ranges::sort(lockOrder, [&keys](std::size_t lhs, std::size_t rhs)
+      {
+        return keys[lhs] < keys[rhs];
+      });
+
+      std::vector<std::shared_lock<std::shared_mutex>> locks;
+      locks.reserve(keys.size());
+      for (std::size_t orderIndex = 0; orderIndex < lockOrder.size(); ++orderIndex)
+      {
+        const std::size_t index = lockOrder[orderIndex];
+        if (orderIndex > 0 && keys[lockOrder[orderIndex - 1]] == keys[index])
+        {
+          continue;
+        }
+
+        locks.emplace_back(data[index]->lock);
+      }
+
+      std::vector<const Val*> values;
+      values.reserve(keys.size());
+      for (const auto* datum : data)
+      {
+        values.emplace_back(&datum->value);
+      }
+
+      return {std::move(values), std::move(locks)};
+    }
+
+    //! Calls the consumer with a copy of every datum in the store.
+    //! Only the data of a shard are collected under its lock, each value is copied
+    //! under its own shared lock, and the consumer is called without any lock held.
+    //! @param consumer Consumer of the key and the value of the datum.
+    template<typename Consumer>
+    void ForEach(const Consumer& consumer)
+    {
+      std::vector<std::pair<const Key*, const Datum<Val>*>> data;
+      for (auto& shard : _shards)
+      {
+        // The nodes are stable and never erased, so the data outlive the shard lock.
+        data.clear();
+        {
+          std::shared_lock shardLock(shard.lock);
+          data.reserve(shard.data.size());
+          for (const auto& [key, datum] : shard.data)
+          {
+            data.emplace_back(&key, &datum);
+          }
+        }
+
+        for (const auto& [key, datum] : data)
+        {
+          const Val value = [datum]()
+          {
+            std::shared_lock lock(datum->lock);
+            return datum->value;
+          }();
+
+          consumer(*key, value);
+        }
+      }
+    }
+
+    //! Inserts or replaces the datum.
+    //! @param key Key of the datum.
+    //! @param value Value of the datum.
+    void Put(const Key& key, Val value)
+    {
+      auto& shard = GetShard(key);
+      std::unique_lock shardLock(shard.lock);
+
+      auto& datum = shard.data[key];
+      std::unique_lock lock(datum.lock);
+      datum.value = std::move(value);
+    }
+
+    //! Marks the datum dirty for the target.
+    //! @param key Key of the datum.
+    //! @param target Target of the dirty data.
+    //! @returns Number of the data marked dirty for the target.
+    std::size_t MarkDirty(const Key& key, DirtyTarget target)
+    {
+      std::scoped_lock lock(_dirtyMutex);
+      auto& dirtyKeys = _dirtyKeys[static_cast<std::size_t>(target)];
+      dirtyKeys.emplace(key);
+      return dirtyKeys.size();
+    }
+
+    //! Copies the values of the data marked dirty for the target, clearing the marks.
+    //! @param target Target of the dirty data.
+    //! @returns Keys and values of the dirty data.
+    std::vector<std::pair<Key, Val>> CollectDirty(DirtyTarget target)
+    {
+      std::unordered_set<Key> dirtyKeys;
+      {
+        std::scoped_lock lock(_dirtyMutex);
+        std::swap(dirtyKeys, _dirtyKeys[static_cast<std::size_t>(target)]);
+      }
+
+      std::vector<std::pair<Key, Val>> values;
+      values.reserve(dirtyKeys.size());
+      for (const auto& key : dirtyKeys)
+      {
+        // Waits for the exclusive access which marked the datum to end.
+        const auto& datum = Find(key);
+        std::shared_lock lock(datum.lock);
+        values.emplace_back(key, datum.value);
+      }
+
+      return values;
+    }
+
+  private:
+    //! Number of the shards.
+    static constexpr std::size_t ShardCount = 16;
+
+    //! Shard of the store.
+    struct Shard
+    {
+      //! A lock guarding the map.
+      std::shared_mutex lock;
+      //! Data of the shard.
+      //! Nodes of the map are stable, rehashing does not move the data.
+      std::unordered_map<Key, Datum<Val>> data;
+    };
+
+    static std::size_t GetShardIndex(const Key& key)
+    {
+      return std::hash<Key>{}(key) % ShardCount;
+    }
+
+    Shard& GetShard(const Key& key)
+    {
+      return _shards[GetShardIndex(key)];
+    }
+
+    //! Loads the datum into the store.
+    //! The loader is called without holding the lock of the shard.
+    Datum<Val>& Load(const Key& key)
+    {
+      auto value = _loader(key);
+      if (!value)
+      {
+        throw std::runtime_error("Datum does not exist");
+      }
+
+      auto& shard = GetShard(key);
+      std::unique_lock lock(shard.lock);
+
+      // Keep the datum if it was loaded by another thread in the meantime.
+      const auto [datumIter, inserted] = shard.data.try_emplace(key);
+      if (inserted)
+      {
+        datumIter->second.value = std::move(*value);
+      }
+
+      return datumIter->second;
+    }
+
+    //! Loader of the data missing in the store.
+    Loader _loader;
+    //! Shards of the store.
+    std::array<Shard, ShardCount> _shards;
+
+    //! Mutex guarding the dirty keys.
+    std::mutex _dirtyMutex;
+    //! Keys of the data marked dirty, for each target.
+    std::array<std::unordered_set<Key>, 2> _dirtyKeys;
+  };
+
+  //! Marks the datum modified, dirty for the storage and the journal.
+  template<typename Key, typename Val>
+  void MarkModified(DatumStore<Key, Val>& store, const Key& key);
+
+  //! Marks the data of the batch dirty for the target.
+  void MarkBatchDirty(const DataBatch& batch, DirtyTarget target);
+  //! Puts the data replayed from the journal to the stores.
+  void ApplyReplayed(DataBatch batch);
+  //! Writes the snapshot, compacting the journal into it.
+  void CompactSnapshot();
+
+  //! Stores the dirty data every interval and writes the snapshots until stopped.
+  void RunWriteBehind(const std::stop_token& stopToken);
+  //! Commits the journal every interval or batch until stopped.
+  void RunJournal(const std::stop_token& stopToken);
+
+  //! A storage of the data.
+  DataStorage& _storage;
+  //! Data settings.
+  Settings::DataSettings _settings;
+  //! Mutex serializing the flushes.
+  std::mutex _flushMutex;
+  //! Flush sequence of the last stored batch.
+  //! Guarded by the flush mutex.
+  uint64_t _flushSequence = 0;
+
+  //! Users.
+  DatumStore<std::string, User> _users;
+  //! Characters.
+  DatumStore<DatumUid, User::Character> _characters;
+  //! Mounts.
+  DatumStore<DatumUid, User::Mount> _mounts;
+  //! Ranches.
+  DatumStore<DatumUid, User::Ranch> _ranches;
+
+  //! A journal of the modified data, if enabled.
+  std::unique_ptr<DataJournal> _journal;
+  //! Mutex serializing the journal commits and rotations.
+  std::mutex _journalMutex;
+  //! Mutex for the journal condition.
+  std::mutex _journalWaitMutex;
+  //! Condition signaled when a batch of the data is modified.
+  std::condition_variable_any _journalCondition;
+  //! Whether a batch of the modified data is waiting for the commit.
+  bool _isJournalBatchPending = false;
+
+  //! Mutex for the write-behind condition.
+  std::mutex _writeBehindMutex;
+  //! Condition the write-behind thread waits on between the flushes.
+  std::condition_variable_any _writeBehindCondition;
+  //! A journal thread.
+  std::jthread _journalThread;
+  //! A write-behind thread, declared last to be stopped first.
+  std::jthread _writeBehindThread;
 };
 
 }
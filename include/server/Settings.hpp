@@ -1,6 +1,7 @@
 #ifndef SETTINGS_HPP
 #define SETTINGS_HPP
 
+#include <string>
 #include <utility>
 
 #include <nlohmann/json.hpp>
@@ -33,6 +34,28 @@ public:
      asio::ip::make_address_v4("127.0.0.1")
     };
     uint16_t messengerAdvPort = 10032;
+
+    // Whether each I/O thread accepts the clients with its own SO_REUSEPORT acceptor.
+    bool reusePort = false;
+
+    // Timeout in seconds in which a connected client must send a command.
+    // Zero disables the timeout.
+    uint32_t handshakeTimeout = 30;
+    // Timeout in seconds in which a client must send a command after its last one,
+    // the heartbeats keep the client alive. Zero disables the timeout.
+    uint32_t idleTimeout = 60;
+
+    // Number of the bytes queued to a client above which its stale supersedable
+    // commands, such as the snapshots, are replaced or dropped. Zero disables the limits.
+    uint32_t writeHighWatermark = 64 * 1024;
+    // Number of the queued bytes below which the client catches up again.
+    uint32_t writeLowWatermark = 16 * 1024;
+    // Number of the queued bytes above which the client is disconnected.
+    // Zero disables the limit.
+    uint32_t writeQueueLimit = 1024 * 1024;
+    // Timeout in seconds in which a client over the high watermark must catch up.
+    // Zero disables the timeout.
+    uint32_t writeStallTimeout = 10;
   } _lobbySettings;
 
   // Bind address and port of the ranch host.
@@ -42,6 +65,32 @@ public:
       asio::ip::address_v4::any()
     };
     uint16_t port = 10031;
+
+    // Rate of the ranch tick in Hz,
+    // at which the snapshots are relayed to the clients.
+    uint32_t tickRate = 20;
+
+    // Whether each I/O thread accepts the clients with its own SO_REUSEPORT acceptor.
+    bool reusePort = false;
+
+    // Timeout in seconds in which a connected client must send a command.
+    // Zero disables the timeout.
+    uint32_t handshakeTimeout = 30;
+    // Timeout in seconds in which a client must send a command after its last one,
+    // the heartbeats keep the client alive. Zero disables the timeout.
+    uint32_t idleTimeout = 60;
+
+    // Number of the bytes queued to a client above which its stale supersedable
+    // commands, such as the snapshots, are replaced or dropped. Zero disables the limits.
+    uint32_t writeHighWatermark = 64 * 1024;
+    // Number of the queued bytes below which the client catches up again.
+    uint32_t writeLowWatermark = 16 * 1024;
+    // Number of the queued bytes above which the client is disconnected.
+    // Zero disables the limit.
+    uint32_t writeQueueLimit = 1024 * 1024;
+    // Timeout in seconds in which a client over the high watermark must catch up.
+    // Zero disables the timeout.
+    uint32_t writeStallTimeout = 10;
   } _ranchSettings;
 
   // Bind address and port of the messenger host.
@@ -53,6 +102,72 @@ public:
     uint16_t port = 10032;
   } _messengerSettings;
 
+  // Network I/O settings.
+  struct NetworkSettings
+  {
+    // Number of I/O threads shared by all the hosts.
+    // Zero selects the number of hardware threads.
+    uint32_t ioThreads = 0;
+    // Interval in milliseconds of the tick of the timing wheel,
+    // the resolution of the client timeouts.
+    uint32_t timerTickInterval = 100;
+  } _networkSettings;
+
+  // Logging settings.
+  struct LoggingSettings
+  {
+    // Policy applied when the log queue is full.
+    enum class OverflowPolicy
+    {
+      // Block the logging thread until there's space in the queue.
+      Block,
+      // Drop the oldest message in the queue.
+      OverrunOldest
+    };
+
+    // Minimal level of the logged messages.
+    std::string level = "debug";
+    // Number of messages the log queue holds.
+    uint32_t queueSize = 8192;
+    // Number of threads writing the queued messages to the sinks.
+    uint32_t threadCount = 1;
+    // Policy applied when the log queue is full.
+    OverflowPolicy overflowPolicy = OverflowPolicy::OverrunOldest;
+  } _loggingSettings;
+
+  // Data settings.
+  struct DataSettings
+  {
+    // Storage of the data.
+    enum class Storage
+    {
+      // Data kept in the memory of the process, lost on exit.
+      Memory,
+      // Data kept in a PostgreSQL database.
+      Postgres
+    };
+
+    // Storage of the data.
+    Storage storage = Storage::Memory;
+    // Connection string of the PostgreSQL database.
+    std::string connectionString;
+    // Interval in milliseconds at which the modified data are stored.
+    uint32_t writeBehindInterval = 1000;
+    // Path of the data snapshot, from which the server warms up on start.
+    // Empty path disables the snapshots.
+    std::string snapshotPath = "data/snapshot.bin";
+    // Interval in seconds at which the snapshot is written.
+    // Zero disables the periodic snapshots.
+    uint32_t snapshotInterval = 300;
+    // Path of the journal of the modified data, replayed on start.
+    // Empty path disables the journal.
+    std::string journalPath = "data/journal.bin";
+    // Interval in milliseconds at which the journal is committed.
+    uint32_t journalInterval = 100;
+    // Number of the modified data which commits the journal before the interval.
+    uint32_t journalBatchSize = 512;
+  } _dataSettings;
+
   // Updates settings from json configuration file
   void LoadFromFile(const std::filesystem::path& filePath);
 
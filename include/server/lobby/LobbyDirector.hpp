@@ -20,6 +20,8 @@ public:
   //!
   explicit LobbyDirector(
     DataDirector& dataDirector,
+    IoContextPool& ioContextPool,
+    TimingWheel& timingWheel,
     Settings::LobbySettings settings = {});
 
 private:
@@ -78,6 +80,10 @@ private:
 
   //!
   CommandServer _server;
+
+  //! Mutex guarding the client state,
+  //! as the handlers of different clients run concurrently.
+  std::mutex _clientsMutex;
   //!
   std::unordered_map<ClientId, DatumUid> _clientCharacters;
 
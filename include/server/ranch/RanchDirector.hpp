@@ -21,9 +21,31 @@ public:
   //!
   explicit RanchDirector(
     DataDirector& dataDirector,
+    IoContextPool& ioContextPool,
+    TimingWheel& timingWheel,
     Settings::RanchSettings settings = {});
 
 private:
+  struct RanchInstance;
+
+  //! Get the ranch instance the client is on.
+  //! @param clientId ID of the client.
+  //! @returns Ranch instance, or null if the client is not on a ranch.
+  RanchInstance* GetClientRanch(ClientId clientId);
+  //! Get the character of the client.
+  //! @param clientId ID of the client.
+  //! @returns Character of the client, or invalid datum if the client has not entered a ranch.
+  DatumUid GetClientCharacter(ClientId clientId);
+
+  //! Schedules the next ranch tick.
+  void ScheduleTick();
+
+  //! Relays the latest snapshots of the ranch entities to the clients on the ranch.
+  void Tick();
+
+  //! Handles the disconnect of a client.
+  void HandleClientDisconnect(ClientId clientId);
+
   //!
   void HandleEnterRanch(
     ClientId clientId,
@@ -74,6 +96,11 @@ private:
     ClientId clientId, 
     const RanchCommandUpdateMountNickname& command);
 
+  //!
+  void HandleHeartbeat(
+    ClientId clientId,
+    const RanchCommandHeartbeat& heartbeat);
+
 
   //!
   Settings::RanchSettings _settings;
@@ -82,14 +109,70 @@ private:
   //!
   CommandServer _server;
 
+  //! Interval of the ranch tick.
+  std::chrono::steady_clock::duration _tickInterval;
+  //! Timer of the ranch tick.
+  asio::steady_timer _tickTimer;
+
+  //! Mutex guarding the client characters, the client ranches and the map of the ranches,
+  //! as the handlers of different clients run concurrently.
+  //! The ranch instances are guarded by their own mutexes, which are never locked with it.
+  std::mutex _clientsMutex;
   //!
   std::unordered_map<ClientId, DatumUid> _clientCharacters;
+  //! Ranches the clients are on.
+  std::unordered_map<ClientId, DatumUid> _clientRanches;
+
+  //! Snapshot of a ranch entity waiting to be relayed.
+  struct PendingSnapshot
+  {
+    //! Client the snapshot was received from.
+    ClientId clientId{};
+    //! Snapshot notification.
+    RanchCommandRanchSnapshotNotify notify{};
+  };
+
+  //! Member of a ranch instance.
+  struct RanchMember
+  {
+    //! Client of the member.
+    ClientId clientId{};
+    //! Character of the member.
+    DatumUid characterUid{};
+    //! Entity of the member's character.
+    EntityId entityId{InvalidEntityId};
+  };
 
   struct RanchInstance
   {
+    //! Adds a member to the ranch, adding its character to the world.
+    //! @param clientId Client of the member.
+    //! @param characterUid Character of the member.
+    //! @returns Entity of the member's character.
+    EntityId AddMember(ClientId clientId, DatumUid characterUid);
+    //! Removes a member from the ranch, removing its character from the world
+    //! and discarding its pending snapshot.
+    //! @param clientId Client of the member.
+    //! @returns Entity of the removed member's character,
+    //!          or invalid entity if the client was not a member.
+    EntityId RemoveMember(ClientId clientId);
+
+    //! Mutex guarding the ranch instance, the ranches are ticked and handled independently.
+    std::mutex _mutex;
     WorldTracker _worldTracker;
+    //! Dense array of the members on the ranch,
+    //! the broadcasts iterate only over these.
+    std::vector<RanchMember> _members;
+    //! Indices of the members in the dense array.
+    std::unordered_map<ClientId, std::size_t> _memberIndices;
+    //! Latest snapshots of the entities received since the last tick.
+    std::unordered_map<EntityId, PendingSnapshot> _pendingSnapshots;
   };
+  //! Ranch instances, which are never removed,
+  //! so the references to them remain valid without the clients mutex.
   std::unordered_map<DatumUid, RanchInstance> _ranches;
+  //! Ranch instances visited by the tick, reused between the ticks.
+  std::vector<RanchInstance*> _tickRanches;
 };
 
 }
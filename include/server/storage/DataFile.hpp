@@ -0,0 +1,49 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+
+#ifndef DATA_FILE_HPP
+#define DATA_FILE_HPP
+
+#include <cstdio>
+#include <filesystem>
+
+namespace alicia
+{
+
+//! Flushes the file and syncs its data to the disk.
+//! @param file File to sync.
+//! @throws std::runtime_error if the file could not be synced.
+void SyncDataFile(std::FILE* file);
+
+//! Syncs the data of the closed file to the disk.
+//! @param path Path of the file.
+//! @throws std::runtime_error if the file could not be synced.
+void SyncDataFile(const std::filesystem::path& path);
+
+//! Syncs the directory containing the file to the disk,
+//! so the creation, the rename or the removal of the file survives a power loss.
+//! Does nothing on the platforms which can't sync a directory.
+//! @param path Path of the file.
+//! @throws std::runtime_error if the directory could not be synced.
+void SyncDataDirectory(const std::filesystem::path& path);
+
+} // namespace alicia
+
+#endif // DATA_FILE_HPP
@@ -0,0 +1,118 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef DATA_JOURNAL_HPP
+#define DATA_JOURNAL_HPP
+
+#include "server/storage/DataRecord.hpp"
+#include "server/storage/DataStorage.hpp"
+
+#include <cstdio>
+#include <filesystem>
+
+namespace alicia
+{
+
+//! Magic of the journal file.
+constexpr uint32_t DataJournalMagic = 0x4E4A4C41; // "ALJN"
+//! Version of the journal format.
+constexpr uint32_t DataJournalVersion = 1;
+
+//! Append-only journal of the data modifications.
+//!
+//! The journal records the whole values of the modified data, so the records
+//! are idempotent and the last record of a datum holds its latest value.
+//! The records are appended in batches, each synced to the disk at once.
+//!
+//! The journal is compacted into a data snapshot by rotating it before
+//! the snapshot is written, and discarding the rotated journal after.
+class DataJournal
+{
+public:
+  //! Default constructor.
+  //! The journal is opened by the replay.
+  //! @param path Path of the journal.
+  explicit DataJournal(std::filesystem::path path);
+  //! Destructor.
+  ~DataJournal();
+
+  //! Deleted copy constructor.
+  DataJournal(const DataJournal&) = delete;
+  //! Deleted copy assignment.
+  DataJournal& operator=(const DataJournal&) = delete;
+
+  //! Replays the rotated and the current journal left by the previous run,
+  //! and opens the journal compacted to the replayed data.
+  //! @returns Latest values of the data in the journal.
+  //! @throws std::runtime_error if the journal could not be opened.
+  [[nodiscard]] DataBatch Replay();
+
+  //! Appends the data and syncs them to the disk.
+  //! On a failure the journal is truncated back to the last synced batch,
+  //! so the records appended by the retry follow the whole records.
+  //! @param batch Data to append.
+  //! @throws std::runtime_error if the data could not be written.
+  void Append(const DataBatch& batch);
+
+  //! Starts a new journal, keeping the current one as the rotated journal
+  //! until it's discarded. The journal is not rotated while there's
+  //! a rotated journal left by a failed compaction.
+  //! @throws std::runtime_error if the journal could not be rotated.
+  void Rotate();
+  //! Discards the rotated journal, after its data were durably written to a snapshot.
+  //! @throws std::runtime_error if the removal could not be synced.
+  void DiscardRotated();
+
+private:
+  //! Opens the file for appending.
+  //! @param path Path of the file.
+  //! @param isNew Whether the file is new and needs the header.
+  //! @throws std::runtime_error if the file could not be opened, the file is closed.
+  void Open(const std::filesystem::path& path, bool isNew);
+  //! Opens the journal again, after a failed rotation closed it.
+  //! @throws std::runtime_error if the journal could not be opened.
+  void Reopen();
+  //! Writes the batch to the file.
+  //! @returns Number of the bytes written.
+  std::size_t Write(const DataBatch& batch);
+  //! Flushes the file and syncs it to the disk.
+  void Sync();
+  //! Discards the data written to the journal past the synced size.
+  //! @throws std::runtime_error if the journal could not be truncated.
+  void Truncate();
+  //! Closes the file.
+  void Close();
+
+  //! A path of the journal.
+  std::filesystem::path _path;
+  //! A path of the rotated journal.
+  std::filesystem::path _rotatedPath;
+  //! A file of the journal.
+  std::FILE* _file = nullptr;
+  //! Size of the journal synced to the disk.
+  std::uintmax_t _syncedSize = 0;
+  //! Indicates whether the journal holds a partial batch past the synced size.
+  bool _isTorn = false;
+  //! A writer of the records.
+  DataRecordWriter _recordWriter;
+};
+
+} // namespace alicia
+
+#endif // DATA_JOURNAL_HPP
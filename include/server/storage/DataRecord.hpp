@@ -0,0 +1,112 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef DATA_RECORD_HPP
+#define DATA_RECORD_HPP
+
+#include "server/storage/DataStorage.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace alicia
+{
+
+//! Kind of the data record.
+enum class DataRecordKind : uint8_t
+{
+  User = 0,
+  Character = 1,
+  Mount = 2,
+  Ranch = 3
+};
+
+//! Size of the record header, the kind and the size of the payload.
+constexpr std::size_t DataRecordHeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+//! Data record is the serialized key and value of a datum,
+//! the unit of the data snapshots and the data journal.
+struct DataRecord
+{
+  //! A kind of the record.
+  DataRecordKind kind;
+  //! A payload of the record, the key followed by the value.
+  std::span<const std::byte> payload;
+};
+
+//! Serializes the data records, reusing its buffer between the records.
+class DataRecordWriter
+{
+public:
+  //! Default constructor.
+  DataRecordWriter();
+
+  //! Serializes the record of the user.
+  //! @returns Serialized record, valid until the next write.
+  std::span<const std::byte> Write(const std::string& name, const User& user);
+  //! Serializes the record of the character.
+  //! @returns Serialized record, valid until the next write.
+  std::span<const std::byte> Write(DatumUid characterUid, const User::Character& character);
+  //! Serializes the record of the mount.
+  //! @returns Serialized record, valid until the next write.
+  std::span<const std::byte> Write(DatumUid mountUid, const User::Mount& mount);
+  //! Serializes the record of the ranch.
+  //! @returns Serialized record, valid until the next write.
+  std::span<const std::byte> Write(DatumUid ranchUid, const User::Ranch& ranch);
+
+private:
+  //! Serializes the record written by the writer, growing the buffer until it fits.
+  template<typename Writer>
+  std::span<const std::byte> WriteRecord(DataRecordKind kind, const Writer& writer);
+
+  //! A buffer the records are serialized to.
+  std::vector<std::byte> _buffer;
+};
+
+//! Reads the records from the data.
+//! Stops at the first record which is not whole.
+//!
+//! @param data Serialized records.
+//! @param consumer Consumer of the records.
+//! @returns Number of the bytes of the whole records read.
+std::size_t ReadDataRecords(
+  std::span<const std::byte> data,
+  const std::function<void(const DataRecord& record)>& consumer);
+
+//! Reads the name of the user from the payload of the record.
+//! The name borrows from the payload.
+std::string_view ReadUserRecordKey(std::span<const std::byte> payload);
+//! Reads the UID of the character, mount or ranch from the payload of the record.
+DatumUid ReadDatumRecordKey(std::span<const std::byte> payload);
+
+//! Reads the user from the payload of the record.
+User ReadUserRecord(std::span<const std::byte> payload);
+//! Reads the character from the payload of the record.
+User::Character ReadCharacterRecord(std::span<const std::byte> payload);
+//! Reads the mount from the payload of the record.
+User::Mount ReadMountRecord(std::span<const std::byte> payload);
+//! Reads the ranch from the payload of the record.
+User::Ranch ReadRanchRecord(std::span<const std::byte> payload);
+
+} // namespace alicia
+
+#endif // DATA_RECORD_HPP
@@ -0,0 +1,167 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef DATA_SNAPSHOT_HPP
+#define DATA_SNAPSHOT_HPP
+
+#include "server/storage/DataRecord.hpp"
+#include "server/storage/DataStorage.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace alicia
+{
+
+//! Magic of the snapshot file.
+constexpr uint32_t DataSnapshotMagic = 0x4E534C41; // "ALSN"
+//! Version of the snapshot format.
+//! Snapshots of other versions are ignored.
+constexpr uint32_t DataSnapshotVersion = 2;
+
+//! Writes the data to a flat snapshot file.
+//! The snapshot is written to a temporary file which replaces
+//! the snapshot on commit, so a crash never leaves a partial snapshot.
+class DataSnapshotWriter
+{
+public:
+  //! Default constructor.
+  //! @param path Path of the snapshot.
+  //! @param sequence Flush sequence of the data stored before the snapshot.
+  //! @throws std::runtime_error if the temporary file could not be created.
+  DataSnapshotWriter(std::filesystem::path path, uint64_t sequence);
+
+  //! Writes the user.
+  void Write(const std::string& name, const User& user);
+  //! Writes the character.
+  void Write(DatumUid characterUid, const User::Character& character);
+  //! Writes the mount.
+  void Write(DatumUid mountUid, const User::Mount& mount);
+  //! Writes the ranch.
+  void Write(DatumUid ranchUid, const User::Ranch& ranch);
+
+  //! Replaces the snapshot with the written data, durably on return.
+  //! @throws std::runtime_error if the snapshot could not be replaced.
+  void Commit();
+
+private:
+  //! Writes the serialized record to the file.
+  void WriteRecord(std::span<const std::byte> record);
+
+  //! A path of the snapshot.
+  std::filesystem::path _path;
+  //! A path of the temporary file.
+  std::filesystem::path _temporaryPath;
+  //! A temporary file.
+  std::ofstream _file;
+  //! A writer of the records.
+  DataRecordWriter _recordWriter;
+};
+
+//! Data storage serving the data from a memory-mapped snapshot,
+//! in front of the authoritative storage.
+//!
+//! The snapshot is only indexed on open, the records are decoded as they are loaded.
+//! A background thread stores the records of the snapshot to the authoritative
+//! storage, after which the snapshot is unmapped and the loads are forwarded.
+//! The data stored through this storage take precedence over the snapshot.
+//!
+//! The snapshot is stamped with the flush sequence of the data stored before it.
+//! The records the authoritative storage stored after that sequence are newer
+//! than the snapshot and are skipped, the rest of the snapshot is served.
+class SnapshotDataStorage final
+  : public DataStorage
+{
+public:
+  //! Default constructor.
+  //! @param path Path of the snapshot.
+  //! @param storage Authoritative storage.
+  //! @throws std::runtime_error if the snapshot is not valid.
+  SnapshotDataStorage(
+    const std::filesystem::path& path,
+    DataStorage& storage);
+
+  [[nodiscard]] std::optional<User> LoadUser(
+    const std::string& name) override;
+  [[nodiscard]] std::optional<User::Character> LoadCharacter(
+    DatumUid characterUid) override;
+  [[nodiscard]] std::optional<User::Mount> LoadMount(
+    DatumUid mountUid) override;
+  [[nodiscard]] std::optional<User::Ranch> LoadRanch(
+    DatumUid ranchUid) override;
+  [[nodiscard]] uint64_t LoadSequence() override;
+  [[nodiscard]] DataKeys LoadKeysStoredAfter(uint64_t sequence) override;
+
+  void Store(const DataBatch& batch) override;
+
+private:
+  //! Stores the records of the snapshot to the authoritative storage until done or stopped.
+  void RunCatchUp(const std::stop_token& stopToken);
+  //! Removes the data from the index of the snapshot.
+  //! Must be called with the index mutex locked exclusively.
+  void Forget(const DataBatch& batch);
+  //! Removes the keys from the index of the snapshot.
+  //! Must be called with the index mutex locked exclusively.
+  void Forget(const DataKeys& keys);
+
+  //! An authoritative storage.
+  DataStorage& _storage;
+  //! Flush sequence of the snapshot.
+  uint64_t _sequence = 0;
+
+  //! Mutex serializing the stores to the authoritative storage.
+  std::mutex _storeMutex;
+
+  //! Mutex guarding the mapping and the index.
+  std::shared_mutex _indexMutex;
+  //! A mapping of the snapshot file.
+  boost::interprocess::file_mapping _mapping;
+  //! A mapped region of the snapshot file.
+  boost::interprocess::mapped_region _region;
+  //! Records of the users by their names.
+  std::unordered_map<std::string, std::span<const std::byte>> _users;
+  //! Records of the characters by their UIDs.
+  std::unordered_map<DatumUid, std::span<const std::byte>> _characters;
+  //! Records of the mounts by their UIDs.
+  std::unordered_map<DatumUid, std::span<const std::byte>> _mounts;
+  //! Records of the ranches by their UIDs.
+  std::unordered_map<DatumUid, std::span<const std::byte>> _ranches;
+
+  //! Mutex for the catch-up condition.
+  std::mutex _catchUpMutex;
+  //! Condition the catch-up thread waits on before retrying a failed store.
+  std::condition_variable_any _catchUpCondition;
+
+  //! A catch-up thread, declared last to be stopped first.
+  std::jthread _catchUpThread;
+};
+
+} // namespace alicia
+
+#endif // DATA_SNAPSHOT_HPP
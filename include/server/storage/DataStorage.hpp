@@ -0,0 +1,166 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef DATA_STORAGE_HPP
+#define DATA_STORAGE_HPP
+
+#include <libserver/command/proto/DataDefines.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace alicia
+{
+
+//! Unique datum identifier.
+using DatumUid = uint32_t;
+//! Invalid datum identifier.
+constexpr DatumUid InvalidDatumUid = 0;
+
+//! Datum consumer is a callback which provides access to a value,
+//! to which access is guaranteed while in the consumer function.
+template<typename T>
+using DatumConsumer = std::function<void(T value)>;
+
+//! User.
+struct User
+{
+  std::string _token;
+
+  DatumUid characterUid;
+
+  //! Character.
+  struct Character
+  {
+    std::string nickName;
+    Gender gender = Gender::Unspecified;
+    uint16_t level{};
+    int32_t carrots{};
+    AgeGroup ageGroup = AgeGroup::Kid;
+
+    std::string status;
+
+    std::vector<Item> characterEquipment;
+    std::vector<Item> horseEquipment;
+
+    DatumUid mountUid{};
+    DatumUid ranchUid{};
+
+    std::vector<DatumUid> horses{};
+  };
+
+  //! Mount.
+  struct Mount
+  {
+    uint32_t tid{};
+    std::string name;
+  };
+
+  //! Ranch
+  struct Ranch
+  {
+    std::string ranchName;
+  };
+};
+
+//! Data stored in a single transaction.
+struct DataBatch
+{
+  //! Users by their names.
+  std::vector<std::pair<std::string, User>> users;
+  //! Characters by their UIDs.
+  std::vector<std::pair<DatumUid, User::Character>> characters;
+  //! Mounts by their UIDs.
+  std::vector<std::pair<DatumUid, User::Mount>> mounts;
+  //! Ranches by their UIDs.
+  std::vector<std::pair<DatumUid, User::Ranch>> ranches;
+  //! Flush sequence of the batch, increasing with every flush of the data.
+  //! The storage records the sequence of every stored datum, and the highest one.
+  uint64_t sequence = 0;
+
+  //! @returns `true` if there are no data in the batch.
+  [[nodiscard]] bool IsEmpty() const noexcept
+  {
+    return users.empty() && characters.empty() && mounts.empty() && ranches.empty();
+  }
+};
+
+//! Keys of the data.
+struct DataKeys
+{
+  //! Names of the users.
+  std::vector<std::string> users;
+  //! UIDs of the characters.
+  std::vector<DatumUid> characters;
+  //! UIDs of the mounts.
+  std::vector<DatumUid> mounts;
+  //! UIDs of the ranches.
+  std::vector<DatumUid> ranches;
+};
+
+//! Data storage persists the data of the users.
+//! The storage must be safe to use from multiple threads.
+class DataStorage
+{
+public:
+  //! Virtual destructor.
+  virtual ~DataStorage() = default;
+
+  //! Loads the user.
+  //! @param name Name of the user.
+  //! @returns The user, or an empty optional if the user does not exist.
+  [[nodiscard]] virtual std::optional<User> LoadUser(
+    const std::string& name) = 0;
+  //! Loads the character.
+  //! @param characterUid UID of the character.
+  //! @returns The character, or an empty optional if the character does not exist.
+  [[nodiscard]] virtual std::optional<User::Character> LoadCharacter(
+    DatumUid characterUid) = 0;
+  //! Loads the mount.
+  //! @param mountUid UID of the mount.
+  //! @returns The mount, or an empty optional if the mount does not exist.
+  [[nodiscard]] virtual std::optional<User::Mount> LoadMount(
+    DatumUid mountUid) = 0;
+  //! Loads the ranch.
+  //! @param ranchUid UID of the ranch.
+  //! @returns The ranch, or an empty optional if the ranch does not exist.
+  [[nodiscard]] virtual std::optional<User::Ranch> LoadRanch(
+    DatumUid ranchUid) = 0;
+  //! Loads the flush sequence of the stored data.
+  //! @returns The highest sequence of the stored batches, zero if none was stored.
+  [[nodiscard]] virtual uint64_t LoadSequence() = 0;
+  //! Loads the keys of the data stored by the batches of a higher flush sequence.
+  //! @param sequence Flush sequence.
+  //! @returns Keys of the data stored after the sequence.
+  [[nodiscard]] virtual DataKeys LoadKeysStoredAfter(uint64_t sequence) = 0;
+
+  //! Stores the data in a single transaction,
+  //! either all of the data are stored or none.
+  //! @param batch Data to store.
+  //! @throws std::runtime_error if the data could not be stored.
+  virtual void Store(const DataBatch& batch) = 0;
+};
+
+} // namespace alicia
+
+#endif // DATA_STORAGE_HPP
@@ -0,0 +1,77 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef MEMORY_DATA_STORAGE_HPP
+#define MEMORY_DATA_STORAGE_HPP
+
+#include "server/storage/DataStorage.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace alicia
+{
+
+//! Data storage keeping the data in the memory of the process.
+//! Used when no database is configured, and by the tests.
+class MemoryDataStorage final
+  : public DataStorage
+{
+public:
+  [[nodiscard]] std::optional<User> LoadUser(
+    const std::string& name) override;
+  [[nodiscard]] std::optional<User::Character> LoadCharacter(
+    DatumUid characterUid) override;
+  [[nodiscard]] std::optional<User::Mount> LoadMount(
+    DatumUid mountUid) override;
+  [[nodiscard]] std::optional<User::Ranch> LoadRanch(
+    DatumUid ranchUid) override;
+  [[nodiscard]] uint64_t LoadSequence() override;
+  [[nodiscard]] DataKeys LoadKeysStoredAfter(uint64_t sequence) override;
+
+  void Store(const DataBatch& batch) override;
+
+private:
+  //! A stored datum.
+  template<typename T>
+  struct Stored
+  {
+    //! A value of the datum.
+    T value;
+    //! Flush sequence of the batch which stored the datum.
+    uint64_t sequence{};
+  };
+
+  //! Mutex guarding the data.
+  std::mutex _mutex;
+  //! Users.
+  std::unordered_map<std::string, Stored<User>> _users;
+  //! Characters.
+  std::unordered_map<DatumUid, Stored<User::Character>> _characters;
+  //! Mounts.
+  std::unordered_map<DatumUid, Stored<User::Mount>> _mounts;
+  //! Ranches.
+  std::unordered_map<DatumUid, Stored<User::Ranch>> _ranches;
+  //! Highest flush sequence of the stored batches.
+  uint64_t _sequence = 0;
+};
+
+} // namespace alicia
+
+#endif // MEMORY_DATA_STORAGE_HPP
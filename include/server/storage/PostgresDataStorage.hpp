@@ -0,0 +1,72 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#ifndef POSTGRES_DATA_STORAGE_HPP
+#define POSTGRES_DATA_STORAGE_HPP
+
+#include "server/storage/DataStorage.hpp"
+
+#include <mutex>
+
+#include <pqxx/pqxx>
+
+namespace alicia
+{
+
+//! Data storage backed by a PostgreSQL database.
+//! The tables are described by `resources/database/schema.sql`.
+//! The storage uses a single connection, the access to which is serialized.
+class PostgresDataStorage final
+  : public DataStorage
+{
+public:
+  //! Default constructor.
+  //! @param connectionString Connection string of the database.
+  //! @throws pqxx::failure if the connection could not be established.
+  explicit PostgresDataStorage(std::string connectionString);
+
+  [[nodiscard]] std::optional<User> LoadUser(
+    const std::string& name) override;
+  [[nodiscard]] std::optional<User::Character> LoadCharacter(
+    DatumUid characterUid) override;
+  [[nodiscard]] std::optional<User::Mount> LoadMount(
+    DatumUid mountUid) override;
+  [[nodiscard]] std::optional<User::Ranch> LoadRanch(
+    DatumUid ranchUid) override;
+  [[nodiscard]] uint64_t LoadSequence() override;
+  [[nodiscard]] DataKeys LoadKeysStoredAfter(uint64_t sequence) override;
+
+  void Store(const DataBatch& batch) override;
+
+private:
+  //! Returns the connection, reconnecting if it was lost.
+  //! Must be called with the mutex locked.
+  pqxx::connection& GetConnection();
+
+  //! A connection string of the database.
+  std::string _connectionString;
+  //! Mutex serializing the access to the connection.
+  std::mutex _mutex;
+  //! A connection to the database.
+  pqxx::connection _connection;
+};
+
+} // namespace alicia
+
+#endif // POSTGRES_DATA_STORAGE_HPP
@@ -7,7 +7,10 @@
 
 #include "server/DataDirector.hpp"
 
+#include <deque>
+#include <span>
 #include <unordered_map>
+#include <vector>
 
 namespace alicia
 {
@@ -17,35 +20,97 @@ using EntityId = uint16_t;
 //!
 constexpr EntityId InvalidEntityId = 0;
 
+//! Allocator of the entity IDs, recycling the IDs of the removed entities.
+//!
+//! The IDs are sent to the clients as 16-bit indices and can't tell their reuses apart.
+//! The freed IDs are reused in the order they were freed, so an ID is reused as late as possible.
+class EntityIdAllocator
+{
+public:
+  //! Allocates an entity ID.
+  //! @returns Allocated entity ID.
+  //! @throws std::runtime_error if all the entity IDs are allocated.
+  [[nodiscard]] EntityId Allocate();
+  //! Frees the entity ID for reuse.
+  //! @param entityId Entity ID to free.
+  //! @returns `true` if the ID was freed, `false` if it wasn't allocated.
+  bool Free(EntityId entityId);
+
+  //! Returns whether the entity ID is allocated.
+  //! @param entityId Entity ID.
+  //! @returns `true` if the ID is allocated, `false` otherwise.
+  [[nodiscard]] bool IsAllocated(EntityId entityId) const;
+
+private:
+  //! Allocation states of the IDs, indexed by the entity ID minus one.
+  std::vector<bool> _allocated;
+  //! Freed entity IDs in the order they were freed.
+  std::deque<EntityId> _freeIds;
+};
+
 //!
 class WorldTracker
 {
 public:
-  //! An entity map.
-  using EntityMap = std::unordered_map<DatumUid, uint16_t>;
+  //! An entity in the world.
+  struct Entity
+  {
+    //! A UID of the datum of the entity.
+    DatumUid uid{};
+    //! An ID of the entity.
+    EntityId id{InvalidEntityId};
+  };
 
-  //!
+  //! Dense array of the entities, iterated contiguously.
+  using Entities = std::span<const Entity>;
+
+  //! Adds the character to the world.
+  //! @returns Entity ID of the character, the existing one if already added.
   EntityId AddCharacter(DatumUid character);
+  //! Removes the character from the world, freeing its entity ID.
+  //! @returns Entity ID the character had, or invalid entity if not in the world.
+  EntityId RemoveCharacter(DatumUid character);
   //!
-  [[nodiscard]] EntityId GetCharacterEntityId(DatumUid character);
-  //!
+  [[nodiscard]] EntityId GetCharacterEntityId(DatumUid character) const;
+  //! Adds the mount to the world.
+  //! @returns Entity ID of the mount, the existing one if already added.
   EntityId AddMount(DatumUid mount);
+  //! Removes the mount from the world, freeing its entity ID.
+  //! @returns Entity ID the mount had, or invalid entity if not in the world.
+  EntityId RemoveMount(DatumUid mount);
   //!
-  [[nodiscard]] EntityId GetMountEntityId(DatumUid mount);
+  [[nodiscard]] EntityId GetMountEntityId(DatumUid mount) const;
 
   //!
-  [[nodiscard]] const EntityMap& GetMountEntities();
+  [[nodiscard]] Entities GetMountEntities() const;
   //!
-  [[nodiscard]] const EntityMap& GetCharacterEntities();
+  [[nodiscard]] Entities GetCharacterEntities() const;
 
 private:
-  //! The next entity ID.
-  EntityId _nextEntityId = 1;
+  //! Entities of a kind, kept dense by moving the last entity
+  //! in place of the removed one.
+  struct EntityArray
+  {
+    //! Dense array of the entities.
+    std::vector<Entity> entities;
+    //! Indices of the entities in the dense array.
+    std::unordered_map<DatumUid, std::size_t> indices;
+  };
+
+  //! Adds the entity to the array, allocating its ID.
+  EntityId Add(EntityArray& array, DatumUid uid);
+  //! Removes the entity from the array, freeing its ID.
+  EntityId Remove(EntityArray& array, DatumUid uid);
+  //! Finds the ID of the entity in the array.
+  [[nodiscard]] static EntityId Find(const EntityArray& array, DatumUid uid);
+
+  //! An allocator of the entity IDs shared by all the entities.
+  EntityIdAllocator _entityIds;
 
   //! Mount entities in the world.
-  EntityMap _mounts;
+  EntityArray _mounts;
   //! Character entities in the world.
-  EntityMap _characters;
+  EntityArray _characters;
 };
 
 } // namespace alicia
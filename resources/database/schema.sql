@@ -0,0 +1,74 @@
+-- Schema of the database used by the PostgreSQL data storage.
+
+CREATE TABLE IF NOT EXISTS users
+(
+  name          TEXT PRIMARY KEY,
+  token         TEXT   NOT NULL DEFAULT '',
+  character_uid BIGINT NOT NULL,
+  sequence      BIGINT NOT NULL DEFAULT 0
+);
+
+CREATE TABLE IF NOT EXISTS characters
+(
+  uid       BIGINT PRIMARY KEY,
+  nick_name TEXT     NOT NULL,
+  gender    SMALLINT NOT NULL DEFAULT 0,
+  level     INTEGER  NOT NULL DEFAULT 0,
+  carrots   INTEGER  NOT NULL DEFAULT 0,
+  age_group SMALLINT NOT NULL DEFAULT 12,
+  status    TEXT     NOT NULL DEFAULT '',
+  mount_uid BIGINT   NOT NULL DEFAULT 0,
+  ranch_uid BIGINT   NOT NULL DEFAULT 0,
+  sequence  BIGINT   NOT NULL DEFAULT 0
+);
+
+-- Equipment of the characters, kind 0 is worn by the character and kind 1 by the horse.
+CREATE TABLE IF NOT EXISTS character_items
+(
+  character_uid BIGINT   NOT NULL REFERENCES characters (uid) ON DELETE CASCADE,
+  kind          SMALLINT NOT NULL,
+  position      INTEGER  NOT NULL,
+  uid           BIGINT   NOT NULL,
+  tid           BIGINT   NOT NULL,
+  val           BIGINT   NOT NULL DEFAULT 0,
+  item_count    BIGINT   NOT NULL DEFAULT 1,
+  PRIMARY KEY (character_uid, kind, position)
+);
+
+CREATE TABLE IF NOT EXISTS character_horses
+(
+  character_uid BIGINT  NOT NULL REFERENCES characters (uid) ON DELETE CASCADE,
+  position      INTEGER NOT NULL,
+  mount_uid     BIGINT  NOT NULL,
+  PRIMARY KEY (character_uid, position)
+);
+
+CREATE TABLE IF NOT EXISTS mounts
+(
+  uid      BIGINT PRIMARY KEY,
+  tid      BIGINT NOT NULL,
+  name     TEXT   NOT NULL DEFAULT '',
+  sequence BIGINT NOT NULL DEFAULT 0
+);
+
+CREATE TABLE IF NOT EXISTS ranches
+(
+  uid      BIGINT PRIMARY KEY,
+  name     TEXT   NOT NULL DEFAULT '',
+  sequence BIGINT NOT NULL DEFAULT 0
+);
+
+-- The sequences are the flush sequences of the batches which stored the rows,
+-- the records of a data snapshot stored after the snapshot are not used.
+CREATE INDEX IF NOT EXISTS users_sequence ON users (sequence);
+CREATE INDEX IF NOT EXISTS characters_sequence ON characters (sequence);
+CREATE INDEX IF NOT EXISTS mounts_sequence ON mounts (sequence);
+CREATE INDEX IF NOT EXISTS ranches_sequence ON ranches (sequence);
+
+-- State of the storage, a single row.
+-- The sequence is the highest flush sequence of the stored data.
+CREATE TABLE IF NOT EXISTS storage_state
+(
+  id       SMALLINT PRIMARY KEY CHECK (id = 0),
+  sequence BIGINT NOT NULL DEFAULT 0
+);
@@ -26,33 +26,44 @@ namespace
 
 void WriteCString(const std::string& value, alicia::SinkStream& buffer)
 {
-  for (char b : value)
-  {
-    buffer.Write(b);
-  }
+  // The string storage is always null-terminated.
+  buffer.Write(value.c_str(), value.size() + 1);
+}
 
+void WriteCStringView(const std::string_view& value, alicia::SinkStream& buffer)
+{
+  buffer.Write(value.data(), value.size());
   buffer.Write(static_cast<char>(0x00));
 }
 
-void ReadCString(std::string& value, alicia::SourceStream& buffer)
+void ReadCStringView(std::string_view& value, alicia::SourceStream& buffer)
 {
-  value.reserve(512);
+  const auto remaining = buffer.GetRemaining();
+  const auto terminator = static_cast<const std::byte*>(
+    std::memchr(remaining.data(), 0, remaining.size()));
 
-  bool readNext = true;
-  do
+  if (terminator == nullptr)
   {
-    char read = '\0';
-    buffer.Read(read);
+    throw std::overflow_error(std::format(
+      "Couldn't read string from the buffer (cursor: {}, available: {}). Missing terminator.",
+      buffer.GetCursor(),
+      buffer.Size()));
+  }
 
-    if (read == '\0')
-    {
-      readNext = false;
-    }
-    else
-    {
-      value += read;
-    }
-  } while (readNext);
+  const auto length = static_cast<std::size_t>(terminator - remaining.data());
+  value = std::string_view(
+    reinterpret_cast<const char*>(remaining.data()),
+    length);
+
+  // Skip the string and its terminator.
+  buffer.Seek(buffer.GetCursor() + length + 1);
+}
+
+void ReadCString(std::string& value, alicia::SourceStream& buffer)
+{
+  std::string_view view;
+  ReadCStringView(view, buffer);
+  value.assign(view);
 }
 
 } // namespace
@@ -97,87 +108,24 @@ asio::ip::address_v4 ResolveHostName(const std::string& host)
 }
 
 DEFINE_WRITER_READER(std::string, WriteCString, ReadCString)
+DEFINE_WRITER_READER(std::string_view, WriteCStringView, ReadCStringView)
 
-SourceStream::SourceStream(Storage buffer)
-    : StreamBase(buffer)
-{
-}
-
-SourceStream::SourceStream(nullptr_t)
-    : StreamBase(nullptr)
-{
-}
-
-SourceStream::SourceStream(SourceStream&& rhs) noexcept
-    : StreamBase(rhs._storage)
-{
-  _cursor = rhs._cursor;
-}
-
-SourceStream& SourceStream::operator=(SourceStream&& rhs) noexcept
-{
-  this->_cursor = rhs._cursor;
-  this->_storage = rhs._storage;
-  return *this;
-}
-
-SinkStream::SinkStream(Storage buffer) noexcept
-    : StreamBase(buffer)
-{
-}
-
-SinkStream::SinkStream(nullptr_t) noexcept
-    : StreamBase(nullptr)
-{
-}
-
-SinkStream::SinkStream(SinkStream&& rhs) noexcept
-    : StreamBase(rhs._storage)
-{
-  _cursor = rhs._cursor;
-}
-
-SinkStream& SinkStream::operator=(SinkStream&& rhs) noexcept
-{
-  this->_cursor = rhs._cursor;
-  this->_storage = rhs._storage;
-  return *this;
-}
-
-void SinkStream::Write(const void* data, std::size_t size)
+void SinkStream::ThrowOverflow(std::size_t size) const
 {
-  if (_cursor + size > _storage.size())
-  {
-    throw std::overflow_error(std::format(
-      "Couldn't write {} bytes to the buffer (cursor: {}, available: {}). Not enough space.",
-      size,
-      _cursor,
-      _storage.size()));
-  }
-
-  // Write the bytes.
-  for (std::size_t byteIdx = 0; byteIdx < size; ++byteIdx)
-  {
-    _storage[_cursor++] = static_cast<const std::byte*>(data)[byteIdx];
-  }
+  throw std::overflow_error(std::format(
+    "Couldn't write {} bytes to the buffer (cursor: {}, available: {}). Not enough space.",
+    size,
+    _cursor,
+    _storage.size()));
 }
 
-void SourceStream::Read(void* data, std::size_t size)
+void SourceStream::ThrowOverflow(std::size_t size) const
 {
-  if (_cursor + size > _storage.size())
-  {
-    throw std::overflow_error(std::format(
-      "Couldn't read {} bytes to the buffer (cursor: {}, available: {}). Not enough space.",
-      size,
-      _cursor,
-      _storage.size()));
-  }
-
-  // Read the bytes.
-  for (std::size_t byteIdx = 0; byteIdx < size; ++byteIdx)
-  {
-    static_cast<std::byte*>(data)[byteIdx] = _storage[_cursor++];
-  }
+  throw std::overflow_error(std::format(
+    "Couldn't read {} bytes to the buffer (cursor: {}, available: {}). Not enough space.",
+    size,
+    _cursor,
+    _storage.size()));
 }
 
 } // namespace alicia
@@ -0,0 +1,121 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "libserver/base/IoContextPool.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <thread>
+
+namespace alicia
+{
+
+IoContextPool::IoContextPool(std::size_t threadCount)
+{
+  if (threadCount == 0)
+  {
+    threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  for (std::size_t idx = 0; idx < threadCount; ++idx)
+  {
+    // Each context is run by exactly one thread.
+    auto& context = _contexts.emplace_back(
+      std::make_unique<asio::io_context>(1));
+    _workGuards.emplace_back(context->get_executor());
+  }
+}
+
+void IoContextPool::Run()
+{
+  spdlog::debug("Running {} I/O threads with the {} backend", _contexts.size(), GetBackendName());
+
+  std::vector<std::jthread> threads;
+  threads.reserve(_contexts.size());
+
+  for (auto& context : _contexts)
+  {
+    threads.emplace_back(
+      [&context]()
+      {
+        // Keep running the context until it is stopped,
+        // an exception escaping a handler must not kill the thread.
+        while (true)
+        {
+          try
+          {
+            context->run();
+            break;
+          }
+          catch (const std::exception& x)
+          {
+            spdlog::error("Unhandled exception in the I/O thread: {}", x.what());
+          }
+        }
+      });
+  }
+
+  // The threads are joined on destruction.
+}
+
+void IoContextPool::Stop()
+{
+  for (auto& workGuard : _workGuards)
+  {
+    workGuard.reset();
+  }
+
+  for (auto& context : _contexts)
+  {
+    context->stop();
+  }
+}
+
+asio::io_context& IoContextPool::GetContext()
+{
+  const auto index = _nextContext++ % _contexts.size();
+  return *_contexts[index];
+}
+
+asio::io_context& IoContextPool::GetContext(std::size_t index)
+{
+  return *_contexts.at(index);
+}
+
+std::size_t IoContextPool::GetSize() const
+{
+  return _contexts.size();
+}
+
+const char* IoContextPool::GetBackendName()
+{
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT)
+  return "io_uring";
+#elif defined(BOOST_ASIO_HAS_IOCP)
+  return "IOCP";
+#elif defined(BOOST_ASIO_HAS_EPOLL)
+  return "epoll";
+#elif defined(BOOST_ASIO_HAS_KQUEUE)
+  return "kqueue";
+#else
+  return "select";
+#endif
+}
+
+} // namespace alicia
@@ -21,40 +21,96 @@
 
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace alicia
 {
 
 namespace
 {
 
+//! Max size of a single read.
 constexpr size_t MaxBufferSize = 4092;
+//! Size of the read buffer of a client.
+//! Leaves room for the unconsumed part of a frame next to a full read.
+constexpr size_t ReadBufferSize = 4 * MaxBufferSize;
+
+//! Number of the bits of the client ID holding the slot index.
+constexpr std::size_t ClientSlotBits = 32;
+//! Mask of the slot index in the client ID.
+constexpr ClientId ClientSlotMask = (ClientId{1} << ClientSlotBits) - 1;
+
+//! Get the index of the client slot from the client ID.
+std::size_t GetClientSlot(ClientId clientId)
+{
+  return clientId & ClientSlotMask;
+}
+
+//! Get the client ID of the next generation of the client slot.
+ClientId GetNextClientId(ClientId clientId)
+{
+  return clientId + (ClientId{1} << ClientSlotBits);
+}
 
 } // anon namespace
 
 Client::Client(
   asio::ip::tcp::socket&& socket,
+  ClientId clientId,
+  const ClientWriteLimits& writeLimits,
   BeginHandler beginHandler,
   EndHandler endHandler,
   ReadHandler readHandler,
-  WriteHandler writeHandler) noexcept
-  : _beginHandler(std::move(beginHandler))
+  ReclaimHandler reclaimHandler,
+  CongestionHandler congestionHandler) noexcept
+  : _clientId(clientId)
+  , _readBuffer(ReadBufferSize)
+  , _writeLimits(writeLimits)
+  , _beginHandler(std::move(beginHandler))
   , _endHandler(std::move(endHandler))
   , _readHandler(std::move(readHandler))
-  , _writeHandler(std::move(writeHandler))
+  , _reclaimHandler(std::move(reclaimHandler))
+  , _congestionHandler(std::move(congestionHandler))
   , _socket(std::move(socket))
 {
 }
 
+void Client::Reset(asio::ip::tcp::socket&& socket, ClientId clientId) noexcept
+{
+  // The client was reclaimed, so nothing else accesses it.
+  _clientId = clientId;
+  _isReclaimed = false;
+
+  _readHead = 0;
+  _readTail = 0;
+  _isReading = false;
+
+  _writeQueue.clear();
+  _writesInFlight.clear();
+  _writeSequence.clear();
+  _isWriting = false;
+  _queuedSize = 0;
+  _isCongested = false;
+
+  _socket = std::move(socket);
+}
+
 void Client::Begin()
 {
   _processIo = true;
-  _beginHandler();
+  _beginHandler(_clientId);
   ReadLoop();
 }
 
 void Client::End()
 {
-  _processIo = false;
+  // The client might be ended by both the read and the write loop.
+  if (!_processIo.exchange(false))
+  {
+    TryReclaim();
+    return;
+  }
 
   try
   {
@@ -66,29 +122,133 @@ void Client::End()
     spdlog::error("Couldn't end connection", x.what());
   }
 
-  _endHandler();
+  _endHandler(_clientId);
+  TryReclaim();
+}
+
+void Client::QueueEnd()
+{
+  asio::post(
+    _socket.get_executor(),
+    [this, clientId = _clientId.load()]()
+    {
+      // The client might have been reset for another connection.
+      if (_clientId != clientId)
+      {
+        return;
+      }
+
+      End();
+    });
 }
 
-void Client::QueueWrite(WriteSupplier writeSupplier)
+void Client::QueueWrite(WriteBuffer buffer, WriteKey key)
 {
-  // ToDo: Write & send timing.
-  // ToDo: Write & send batching.
   if (!_processIo)
   {
     return;
   }
 
-  // ToDo: Consider frame-based write loop instead of real-time writes.
-  // Call the supplier.
-  writeSupplier(_writeBuffer);
-  _writeHandler(_writeBuffer);
+  // The write queue and the socket are only ever accessed
+  // on the executor of the client.
+  asio::post(
+    _socket.get_executor(),
+    [this, clientId = _clientId.load(), buffer = std::move(buffer), key]() mutable
+    {
+      // The client might have been reset for another connection.
+      if (!_processIo || _clientId != clientId)
+      {
+        return;
+      }
 
-  // Send the whole buffer.
+      // The congested client only receives the latest of the supersedable writes.
+      // The stale write still queued is replaced, keeping its place in the queue,
+      // otherwise the write is queued as any other.
+      if (_isCongested && key != 0)
+      {
+        const auto writeItr = std::ranges::find(_writeQueue, key, &QueuedWrite::key);
+        if (writeItr != _writeQueue.cend())
+        {
+          _queuedSize = _queuedSize - writeItr->buffer->size() + buffer->size();
+          writeItr->buffer = std::move(buffer);
+          return;
+        }
+      }
+
+      if (_writeLimits.maxQueuedSize != 0
+        && _queuedSize + buffer->size() > _writeLimits.maxQueuedSize)
+      {
+        spdlog::warn(
+          "Client {} exceeded the limit of the queued writes with {} bytes",
+          clientId,
+          _queuedSize + buffer->size());
+        End();
+        return;
+      }
+
+      _queuedSize += buffer->size();
+      _writeQueue.emplace_back(QueuedWrite{.buffer = std::move(buffer), .key = key});
+
+      if (!_isCongested
+        && _writeLimits.highWatermark != 0
+        && _queuedSize > _writeLimits.highWatermark)
+      {
+        _isCongested = true;
+        _congestionHandler(_clientId, true);
+      }
+
+      if (_isWriting)
+      {
+        // The queued buffer is going to be sent
+        // by the scheduled or the in-progress write loop.
+        return;
+      }
+
+      // Schedule the write loop after the handlers which are already queued,
+      // so that the writes queued by them are coalesced into one gather write.
+      _isWriting = true;
+      asio::post(
+        _socket.get_executor(),
+        [this]()
+        {
+          WriteLoop();
+        });
+    });
+}
+
+ClientId Client::GetId() const
+{
+  return _clientId;
+}
+
+void Client::WriteLoop() noexcept
+{
+  if (!_processIo || _writeQueue.empty())
+  {
+    _writeQueue.clear();
+    _isWriting = false;
+    TryReclaim();
+    return;
+  }
+
+  // Take all the queued buffers.
+  _writeSequence.clear();
+  for (auto& write : _writeQueue)
+  {
+    _writeSequence.emplace_back(asio::buffer(*write.buffer));
+    _writesInFlight.emplace_back(std::move(write.buffer));
+  }
+  _writeQueue.clear();
+
+  // Send the buffers with a single gather write.
   asio::async_write(
     _socket,
-    _writeBuffer.data(),
+    _writeSequence,
     [&](boost::system::error_code error, std::size_t size)
     {
+      // Release the sent buffers.
+      _writesInFlight.clear();
+
       try
       {
         if (error)
@@ -99,16 +259,26 @@ void Client::QueueWrite(WriteSupplier writeSupplier)
               error.what()));
         }
 
-        // Consume the sent bytes.
-        _writeBuffer.consume(size);
+        _queuedSize -= size;
+
+        // The client recovers once its writes drain below the low watermark.
+        if (_isCongested && _queuedSize <= _writeLimits.lowWatermark)
+        {
+          _isCongested = false;
+          _congestionHandler(_clientId, false);
+        }
+
+        // Continue the write loop.
+        WriteLoop();
       }
       catch (const std::exception& x)
       {
-        End();
+        _isWriting = false;
+
         spdlog::error(
           "Error in the client write loop: {}",
           x.what());
-        _socket.close();
+        End();
       }
     });
 }
@@ -116,17 +286,40 @@ void Client::QueueWrite(WriteSupplier writeSupplier)
 void Client::ReadLoop() noexcept
 {
   // ToDo: Read & receive timing.
-  // ToDo: Read & receive batching.
   if (!_processIo)
   {
+    TryReclaim();
+    return;
+  }
+
+  // Move the unconsumed bytes to the front of the buffer,
+  // when there's not enough space left behind them for a full read.
+  if (_readBuffer.size() - _readTail < MaxBufferSize)
+  {
+    std::memmove(
+      _readBuffer.data(),
+      _readBuffer.data() + _readHead,
+      _readTail - _readHead);
+    _readTail -= _readHead;
+    _readHead = 0;
+  }
+
+  const auto freeSize = _readBuffer.size() - _readTail;
+  if (freeSize == 0)
+  {
+    spdlog::error("Error in the client read loop: Read buffer overflow");
+    End();
     return;
   }
 
   // Chain the asynchronous functions.
+  _isReading = true;
   _socket.async_read_some(
-    _readBuffer.prepare(MaxBufferSize),
+    asio::buffer(_readBuffer.data() + _readTail, freeSize),
     [&](boost::system::error_code error, std::size_t size)
     {
+      _isReading = false;
+
       try
       {
         if (error)
@@ -135,66 +328,232 @@ void Client::ReadLoop() noexcept
             fmt::format("Network error (0x{}): {}", error.value(), error.what()));
         }
 
-        // Commit the received bytes, so they can be read by the handler.
-        _readBuffer.commit(size);
-        _readHandler(_readBuffer);
+        _readTail += size;
+
+        // The handler reads the received bytes directly from the buffer.
+        const std::size_t consumedSize = _readHandler(_clientId, {
+          _readBuffer.data() + _readHead,
+          _readTail - _readHead});
+        assert(consumedSize <= _readTail - _readHead);
+
+        _readHead += consumedSize;
+        if (_readHead == _readTail)
+        {
+          // Nothing left to keep, start at the front of the buffer.
+          _readHead = 0;
+          _readTail = 0;
+        }
 
         // Continue the read loop.
         ReadLoop();
       }
       catch (const std::exception& x)
       {
-        End();
-
         spdlog::error("Error in the client read loop: {}", x.what());
-        _socket.close();
+        End();
       }
     });
 }
 
+void Client::TryReclaim() noexcept
+{
+  // The client is reclaimed once, after the read and the write loop stopped.
+  if (_processIo || _isReading || _isWriting || _isReclaimed)
+  {
+    return;
+  }
+
+  _isReclaimed = true;
+  _reclaimHandler(_clientId);
+}
+
 Server::Server(
+  IoContextPool& ioContextPool,
   ClientConnectHandler clientConnectHandler,
   ClientDisconnectHandler clientDisconnectHandler,
-  ClientReadHandler clientReadHandler,
-  ClientWriteHandler clientWriteHandler) noexcept
+  ClientReadHandler clientReadHandler) noexcept
   : _clientConnectHandler(std::move(clientConnectHandler))
   , _clientDisconnectHandler(std::move(clientDisconnectHandler))
   , _clientReadHandler(std::move(clientReadHandler))
-  , _clientWriteHandler(std::move(clientWriteHandler))
-  , _io_ctx()
-  , _acceptor(_io_ctx)
+  , _ioContextPool(ioContextPool)
 {
 }
 
-void Server::Host(const asio::ip::address& address, uint16_t port)
+void Server::Host(const asio::ip::address& address, uint16_t port, bool reusePort)
 {
   const asio::ip::tcp::endpoint server_endpoint(address, port);
 
-  _acceptor.open(server_endpoint.protocol());
-  _acceptor.bind(server_endpoint);
-  _acceptor.listen();
+#ifndef SO_REUSEPORT
+  if (reusePort)
+  {
+    spdlog::warn("SO_REUSEPORT is not supported on this platform, using a single acceptor");
+    reusePort = false;
+  }
+#endif
 
-  // Run the accept loop.
-  AcceptLoop();
+  if (reusePort)
+  {
+    // Each context accepts its own clients.
+    for (std::size_t idx = 0; idx < _ioContextPool.GetSize(); ++idx)
+    {
+      auto& context = _ioContextPool.GetContext(idx);
+      _acceptors.emplace_back(std::make_unique<Acceptor>(Acceptor{
+        .acceptor = OpenAcceptor(context, server_endpoint, true),
+        .clientContext = &context}));
+    }
+  }
+  else
+  {
+    _acceptors.emplace_back(std::make_unique<Acceptor>(Acceptor{
+      .acceptor = OpenAcceptor(_ioContextPool.GetContext(), server_endpoint, false)}));
+  }
 
-  _io_ctx.run();
+  // Run the accept loops.
+  for (auto& acceptor : _acceptors)
+  {
+    AcceptLoop(*acceptor);
+  }
 }
 
-Client& Server::GetClient(ClientId clientId)
+asio::ip::tcp::acceptor Server::OpenAcceptor(
+  asio::io_context& context,
+  const asio::ip::tcp::endpoint& endpoint,
+  bool reusePort)
 {
-  const auto clientItr = _clients.find(clientId);
-  if (clientItr == _clients.end())
+  asio::ip::tcp::acceptor acceptor(context);
+  acceptor.open(endpoint.protocol());
+
+#ifdef SO_REUSEPORT
+  if (reusePort)
   {
-    throw std::runtime_error("Invalid client Id");
+    using ReusePort = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+    acceptor.set_option(ReusePort(true));
   }
+#endif
 
-  return clientItr->second;
+  acceptor.bind(endpoint);
+  acceptor.listen();
+  return acceptor;
 }
 
-void Server::AcceptLoop() noexcept
+void Server::EnableTimeouts(TimingWheel& timingWheel, ClientTimeouts timeouts)
 {
-  _acceptor.async_accept(
-    [&](boost::system::error_code error, asio::ip::tcp::socket client_socket)
+  _timingWheel = &timingWheel;
+  _timeouts = timeouts;
+  _timeoutListenerId = _timingWheel->AddListener(
+    [this](std::span<const ClientId> clientIds)
+    {
+      HandleTimeouts(clientIds);
+    });
+  _stallListenerId = _timingWheel->AddListener(
+    [this](std::span<const ClientId> clientIds)
+    {
+      HandleStalls(clientIds);
+    });
+}
+
+void Server::EnableWriteLimits(ClientWriteLimits writeLimits)
+{
+  _writeLimits = writeLimits;
+}
+
+void Server::QueueWrite(ClientId clientId, WriteBuffer buffer, WriteKey key)
+{
+  // The client can't be reclaimed while the write is queued.
+  std::scoped_lock lock(_clientsMutex);
+
+  const std::size_t slot = GetClientSlot(clientId);
+  if (slot >= _clients.size() || _clients[slot]->GetId() != clientId)
+  {
+    return;
+  }
+
+  _clients[slot]->QueueWrite(std::move(buffer), key);
+}
+
+void Server::ReclaimClient(ClientId clientId)
+{
+  std::scoped_lock lock(_clientsMutex);
+
+  const std::size_t slot = GetClientSlot(clientId);
+  assert(slot < _clients.size() && _clients[slot]->GetId() == clientId);
+
+  _freeClientSlots.emplace_back(slot);
+}
+
+void Server::ScheduleTimeout(ClientId clientId, std::chrono::milliseconds timeout)
+{
+  if (_timingWheel == nullptr)
+  {
+    return;
+  }
+
+  if (timeout.count() == 0)
+  {
+    _timingWheel->Cancel(_timeoutListenerId, clientId);
+    return;
+  }
+
+  _timingWheel->Schedule(_timeoutListenerId, clientId, timeout);
+}
+
+void Server::HandleCongestion(ClientId clientId, bool congested)
+{
+  if (_timingWheel == nullptr || _timeouts.stall.count() == 0)
+  {
+    return;
+  }
+
+  // The congested client has to drain its writes before the stall timeout.
+  if (congested)
+  {
+    _timingWheel->Schedule(_stallListenerId, clientId, _timeouts.stall);
+  }
+  else
+  {
+    _timingWheel->Cancel(_stallListenerId, clientId);
+  }
+}
+
+void Server::HandleTimeouts(std::span<const ClientId> clientIds)
+{
+  spdlog::info("Disconnecting {} timed out clients", clientIds.size());
+  EndClients(clientIds);
+}
+
+void Server::HandleStalls(std::span<const ClientId> clientIds)
+{
+  spdlog::info("Disconnecting {} stalled clients", clientIds.size());
+  EndClients(clientIds);
+}
+
+void Server::EndClients(std::span<const ClientId> clientIds)
+{
+  std::scoped_lock lock(_clientsMutex);
+  for (const ClientId clientId : clientIds)
+  {
+    const std::size_t slot = GetClientSlot(clientId);
+    if (slot >= _clients.size() || _clients[slot]->GetId() != clientId)
+    {
+      continue;
+    }
+
+    _clients[slot]->QueueEnd();
+  }
+}
+
+void Server::AcceptLoop(Acceptor& acceptor) noexcept
+{
+  // Each client socket is bound to its own strand on one of the pooled contexts,
+  // or on the context of the acceptor, keeping the client on the accepting thread.
+  // The strand serializes the handlers of the client, preserving the order of its I/O.
+  auto& clientContext = acceptor.clientContext != nullptr
+    ? *acceptor.clientContext
+    : _ioContextPool.GetContext();
+
+  acceptor.acceptor.async_accept(
+    asio::make_strand(clientContext),
+    [this, &acceptor](boost::system::error_code error, asio::ip::tcp::socket client_socket)
     {
       try
       {
@@ -206,40 +565,84 @@ void Server::AcceptLoop() noexcept
               error.what()));
         }
 
-        // Sequential Id.
-        const ClientId clientId = _client_id++;
-        // Create the client.
-        const auto [itr, emplaced] = _clients.try_emplace(
-          clientId,
-          std::move(client_socket),
-          [this, clientId]()
-          {
-            // Invoke the connect handler.
-            _clientConnectHandler(clientId);
-          },
-          [this, clientId]()
-          {
-            // Invoke the disconnect handler.
-            _clientDisconnectHandler(clientId);
-          },
-          [this, clientId](asio::streambuf& readBuffer)
-          {
-            // Invoke the read handler.
-            _clientReadHandler(clientId, readBuffer);
-          },
-          [this, clientId](asio::streambuf& readBuffer)
-          {
-            // Invoke the write handler.
-            _clientWriteHandler(clientId, readBuffer);
-          });
+        // Strand of the client.
+        const auto clientExecutor = client_socket.get_executor();
+
+        std::unique_lock lock(_clientsMutex);
+
+        Client* client = nullptr;
+        if (!_freeClientSlots.empty())
+        {
+          // Reuse the most recently reclaimed client, with the next generation of its ID.
+          client = _clients[_freeClientSlots.back()].get();
+          _freeClientSlots.pop_back();
+
+          client->Reset(std::move(client_socket), GetNextClientId(client->GetId()));
+        }
+        else
+        {
+          // Create the client in a new slot.
+          const ClientId clientId = _clients.size();
+          client = _clients.emplace_back(std::make_unique<Client>(
+            std::move(client_socket),
+            clientId,
+            _writeLimits,
+            [this](ClientId clientId)
+            {
+              // The client has to send its first data before the handshake timeout.
+              ScheduleTimeout(
+                clientId,
+                _timeouts.handshake.count() != 0 ? _timeouts.handshake : _timeouts.idle);
+
+              // Invoke the connect handler.
+              _clientConnectHandler(clientId);
+            },
+            [this](ClientId clientId)
+            {
+              if (_timingWheel != nullptr)
+              {
+                _timingWheel->Cancel(_timeoutListenerId, clientId);
+                _timingWheel->Cancel(_stallListenerId, clientId);
+              }
+
+              // Invoke the disconnect handler.
+              _clientDisconnectHandler(clientId);
+            },
+            [this](ClientId clientId, std::span<std::byte> readBuffer)
+            {
+              // Invoke the read handler.
+              const std::size_t consumedSize = _clientReadHandler(clientId, readBuffer);
+
+              // Any consumed data extend the deadline of the client.
+              if (consumedSize != 0)
+              {
+                ScheduleTimeout(clientId, _timeouts.idle);
+              }
+
+              return consumedSize;
+            },
+            [this](ClientId clientId)
+            {
+              ReclaimClient(clientId);
+            },
+            [this](ClientId clientId, bool congested)
+            {
+              HandleCongestion(clientId, congested);
+            })).get();
+        }
 
-        // Id is sequential so emplacement should never fail.
-        assert(emplaced);
+        lock.unlock();
 
-        itr->second.Begin();
+        // Begin the client on its own strand.
+        asio::dispatch(
+          clientExecutor,
+          [client]()
+          {
+            client->Begin();
+          });
 
         // Continue the accept loop.
-        AcceptLoop();
+        AcceptLoop(acceptor);
       }
       catch (const std::exception& x)
       {
@@ -250,4 +653,4 @@ void Server::AcceptLoop() noexcept
     });
 }
 
-} // namespace alicia
\ No newline at end of file
+} // namespace alicia
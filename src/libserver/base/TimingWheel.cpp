@@ -0,0 +1,307 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "libserver/base/TimingWheel.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace alicia
+{
+
+TimingWheel::TimingWheel(
+  asio::io_context& ioContext,
+  std::chrono::milliseconds tickInterval)
+  : _tickInterval(std::max(tickInterval, std::chrono::milliseconds(1)))
+  , _timer(ioContext)
+{
+  for (auto& wheel : _slots)
+  {
+    wheel.fill(NoEntry);
+  }
+}
+
+TimingWheel::ListenerId TimingWheel::AddListener(ExpiryHandler handler)
+{
+  assert(!_isTicking);
+
+  std::scoped_lock lock(_mutex);
+  _listeners.emplace_back(Listener{
+    .handler = std::move(handler),
+    .entries = {},
+    .expired = {}});
+  return _listeners.size() - 1;
+}
+
+void TimingWheel::Start()
+{
+  _isTicking = true;
+  _nextTickTime = std::chrono::steady_clock::now() + _tickInterval;
+  WaitTick();
+}
+
+void TimingWheel::Stop()
+{
+  _isTicking = false;
+  asio::post(
+    _timer.get_executor(),
+    [this]()
+    {
+      _timer.cancel();
+    });
+}
+
+void TimingWheel::Schedule(
+  ListenerId listenerId,
+  ClientId clientId,
+  std::chrono::milliseconds timeout)
+{
+  // The deadline is at least one tick away, rounded up to the next tick.
+  const uint64_t timeoutTicks = std::max<uint64_t>(
+    (timeout.count() + _tickInterval.count() - 1) / _tickInterval.count(),
+    1);
+
+  std::scoped_lock lock(_mutex);
+
+  auto& listener = _listeners[listenerId];
+  const uint64_t deadline = _currentTick + timeoutTicks;
+
+  const auto [entryItr, inserted] = listener.entries.try_emplace(clientId, NoEntry);
+  if (!inserted)
+  {
+    auto& entry = _entries[entryItr->second];
+
+    // A later deadline is only recorded, the entry is relinked
+    // once its earlier slot is reached. This keeps extending
+    // the deadline on every activity of the client cheap.
+    if (deadline >= entry.deadline)
+    {
+      entry.deadline = deadline;
+      return;
+    }
+
+    Unlink(entryItr->second);
+    entry.deadline = deadline;
+    Link(entryItr->second);
+    return;
+  }
+
+  uint32_t entryIndex = NoEntry;
+  if (!_freeEntries.empty())
+  {
+    entryIndex = _freeEntries.back();
+    _freeEntries.pop_back();
+  }
+  else
+  {
+    entryIndex = static_cast<uint32_t>(_entries.size());
+    _entries.emplace_back();
+  }
+
+  _entries[entryIndex] = Entry{
+    .listenerId = listenerId,
+    .clientId = clientId,
+    .deadline = deadline};
+  entryItr->second = entryIndex;
+  Link(entryIndex);
+}
+
+void TimingWheel::Cancel(ListenerId listenerId, ClientId clientId)
+{
+  std::scoped_lock lock(_mutex);
+
+  auto& listener = _listeners[listenerId];
+  const auto entryItr = listener.entries.find(clientId);
+  if (entryItr == listener.entries.cend())
+  {
+    return;
+  }
+
+  const uint32_t entryIndex = entryItr->second;
+  listener.entries.erase(entryItr);
+
+  Unlink(entryIndex);
+  Free(entryIndex);
+}
+
+void TimingWheel::Tick()
+{
+  {
+    std::scoped_lock lock(_mutex);
+    ++_currentTick;
+
+    // Find the highest wheel which completed a revolution of its slot.
+    std::size_t cascadeWheel = 0;
+    while (cascadeWheel + 1 < WheelCount
+      && (_currentTick & ((uint64_t{1} << (SlotBits * (cascadeWheel + 1))) - 1)) == 0)
+    {
+      ++cascadeWheel;
+    }
+
+    // Cascade the entries of the reached slots down to the finer wheels,
+    // starting at the coarsest so the entries can cascade through several wheels.
+    for (std::size_t wheel = cascadeWheel; wheel > 0; --wheel)
+    {
+      const std::size_t slot = (_currentTick >> (SlotBits * wheel)) & (SlotCount - 1);
+      uint32_t entryIndex = Detach(wheel, slot);
+      while (entryIndex != NoEntry)
+      {
+        const uint32_t nextIndex = _entries[entryIndex].next;
+        Link(entryIndex);
+        entryIndex = nextIndex;
+      }
+    }
+
+    // Expire the entries of the current slot of the finest wheel.
+    uint32_t entryIndex = Detach(0, _currentTick & (SlotCount - 1));
+    while (entryIndex != NoEntry)
+    {
+      auto& entry = _entries[entryIndex];
+      const uint32_t nextIndex = entry.next;
+
+      if (entry.deadline > _currentTick)
+      {
+        // The deadline was extended since the entry was linked.
+        Link(entryIndex);
+      }
+      else
+      {
+        auto& listener = _listeners[entry.listenerId];
+        listener.expired.emplace_back(entry.clientId);
+        listener.entries.erase(entry.clientId);
+        Free(entryIndex);
+      }
+
+      entryIndex = nextIndex;
+    }
+  }
+
+  // The handlers are invoked without the lock, so they may schedule and cancel the deadlines.
+  // The expired clients are only accessed by the tick.
+  for (auto& listener : _listeners)
+  {
+    if (listener.expired.empty())
+    {
+      continue;
+    }
+
+    try
+    {
+      listener.handler(listener.expired);
+    }
+    catch (const std::exception& x)
+    {
+      spdlog::error("Error in the timing wheel expiry handler: {}", x.what());
+    }
+
+    listener.expired.clear();
+  }
+}
+
+void TimingWheel::Link(uint32_t entryIndex)
+{
+  auto& entry = _entries[entryIndex];
+
+  // Deadlines beyond the range of the wheels are linked at its end.
+  const uint64_t distance = std::min(
+    entry.deadline > _currentTick ? entry.deadline - _currentTick : 0,
+    MaxDeadlineDistance);
+  const uint64_t linkedTick = _currentTick + distance;
+
+  // The entry is linked in the finest wheel whose revolution covers the distance.
+  std::size_t wheel = 0;
+  while (wheel + 1 < WheelCount
+    && distance >= (uint64_t{1} << (SlotBits * (wheel + 1))))
+  {
+    ++wheel;
+  }
+
+  entry.wheel = static_cast<uint32_t>(wheel);
+  entry.slot = static_cast<uint32_t>((linkedTick >> (SlotBits * wheel)) & (SlotCount - 1));
+
+  auto& head = _slots[entry.wheel][entry.slot];
+  entry.previous = NoEntry;
+  entry.next = head;
+  if (head != NoEntry)
+  {
+    _entries[head].previous = entryIndex;
+  }
+  head = entryIndex;
+}
+
+void TimingWheel::Unlink(uint32_t entryIndex)
+{
+  auto& entry = _entries[entryIndex];
+
+  if (entry.previous != NoEntry)
+  {
+    _entries[entry.previous].next = entry.next;
+  }
+  else
+  {
+    _slots[entry.wheel][entry.slot] = entry.next;
+  }
+
+  if (entry.next != NoEntry)
+  {
+    _entries[entry.next].previous = entry.previous;
+  }
+
+  entry.previous = NoEntry;
+  entry.next = NoEntry;
+}
+
+uint32_t TimingWheel::Detach(std::size_t wheel, std::size_t slot)
+{
+  const uint32_t head = _slots[wheel][slot];
+  _slots[wheel][slot] = NoEntry;
+  return head;
+}
+
+void TimingWheel::Free(uint32_t entryIndex)
+{
+  _freeEntries.emplace_back(entryIndex);
+}
+
+void TimingWheel::WaitTick()
+{
+  _timer.expires_at(_nextTickTime);
+  _timer.async_wait(
+    [this](const boost::system::error_code& error)
+    {
+      if (error || !_isTicking)
+      {
+        return;
+      }
+
+      // Catch up with the ticks missed while the I/O context was busy.
+      const auto now = std::chrono::steady_clock::now();
+      while (_nextTickTime <= now)
+      {
+        Tick();
+        _nextTickTime += _tickInterval;
+      }
+
+      WaitTick();
+    });
+}
+
+} // namespace alicia
@@ -0,0 +1,173 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "libserver/command/CommandCodec.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #define ALICIA_CODEC_X86_64
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+  #endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define ALICIA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define ALICIA_TARGET_AVX2
+#endif
+
+namespace alicia
+{
+
+namespace
+{
+
+//! XOR kernel applying the key to the data in place.
+using XorKernel = void (*)(std::byte* data, std::size_t size, const XorCode& key);
+
+//! Applies the key to the data one byte at a time.
+//! The data must begin at a multiple of the key size.
+void XorScalar(std::byte* data, std::size_t size, const XorCode& key)
+{
+  for (std::size_t idx = 0; idx < size; ++idx)
+  {
+    data[idx] ^= key[idx & 3];
+  }
+}
+
+//! Applies the key to the data eight bytes at a time.
+void XorWord(std::byte* data, std::size_t size, const XorCode& key)
+{
+  uint32_t key32;
+  std::memcpy(&key32, key.data(), sizeof(key32));
+  const uint64_t key64 = static_cast<uint64_t>(key32) << 32 | key32;
+
+  std::size_t idx = 0;
+  for (; idx + sizeof(key64) <= size; idx += sizeof(key64))
+  {
+    uint64_t word;
+    std::memcpy(&word, data + idx, sizeof(word));
+    word ^= key64;
+    std::memcpy(data + idx, &word, sizeof(word));
+  }
+
+  // The word size is a multiple of the key size,
+  // the tail begins with the first byte of the key.
+  XorScalar(data + idx, size - idx, key);
+}
+
+#ifdef ALICIA_CODEC_X86_64
+
+//! Applies the key to the data sixteen bytes at a time.
+//! SSE2 is part of the x86-64 baseline.
+void XorSse2(std::byte* data, std::size_t size, const XorCode& key)
+{
+  int32_t key32;
+  std::memcpy(&key32, key.data(), sizeof(key32));
+  const __m128i keyVector = _mm_set1_epi32(key32);
+
+  std::size_t idx = 0;
+  for (; idx + sizeof(__m128i) <= size; idx += sizeof(__m128i))
+  {
+    const auto block = reinterpret_cast<__m128i*>(data + idx);
+    _mm_storeu_si128(block, _mm_xor_si128(_mm_loadu_si128(block), keyVector));
+  }
+
+  XorWord(data + idx, size - idx, key);
+}
+
+//! Applies the key to the data thirty-two bytes at a time.
+ALICIA_TARGET_AVX2 void XorAvx2(std::byte* data, std::size_t size, const XorCode& key)
+{
+  int32_t key32;
+  std::memcpy(&key32, key.data(), sizeof(key32));
+  const __m256i keyVector = _mm256_set1_epi32(key32);
+
+  std::size_t idx = 0;
+  for (; idx + sizeof(__m256i) <= size; idx += sizeof(__m256i))
+  {
+    const auto block = reinterpret_cast<__m256i*>(data + idx);
+    _mm256_storeu_si256(block, _mm256_xor_si256(_mm256_loadu_si256(block), keyVector));
+  }
+
+  XorSse2(data + idx, size - idx, key);
+}
+
+//! Checks whether the processor and the operating system support AVX2.
+bool IsAvx2Supported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  // The operating system must preserve the YMM registers.
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+  {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+#endif
+
+//! Selects the fastest kernel supported by the processor.
+XorKernel SelectXorKernel()
+{
+#ifdef ALICIA_CODEC_X86_64
+  if (IsAvx2Supported())
+  {
+    return XorAvx2;
+  }
+  return XorSse2;
+#else
+  return XorWord;
+#endif
+}
+
+//! Applies the XOR key to the data in place.
+void ApplyXorCode(std::span<std::byte> data, const XorCode& key)
+{
+  static const XorKernel kernel = SelectXorKernel();
+  kernel(data.data(), data.size(), key);
+}
+
+} // anon namespace
+
+void DecodeCommandData(std::span<std::byte> data, const XorCode& key)
+{
+  ApplyXorCode(data, key);
+}
+
+void EncodeCommandData(std::span<std::byte> data, const XorCode& key)
+{
+  ApplyXorCode(data, key);
+}
+
+} // namespace alicia
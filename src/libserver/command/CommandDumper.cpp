@@ -0,0 +1,236 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "libserver/command/CommandDumper.hpp"
+
+#include <limits>
+
+namespace alicia
+{
+
+namespace
+{
+
+//! Max number of the queued dumps.
+//! Dumps queued over the limit are dropped.
+constexpr std::size_t MaxQueuedDumps = 1024;
+
+//! Number of the bytes in a row of the dump.
+constexpr std::size_t BytesPerRow = 16;
+
+//! Formats the bytes as rows of hexadecimal values followed by their printable characters.
+//! @param data Data to format.
+//! @returns Formatted data.
+std::string FormatBytes(std::span<const std::byte> data)
+{
+  constexpr std::string_view HexDigits = "0123456789ABCDEF";
+
+  std::string text;
+  // Every row is 3 characters per byte, the separators and the characters.
+  text.reserve((data.size() / BytesPerRow + 1) * (BytesPerRow * 4 + 4));
+
+  for (std::size_t rowOffset = 0; rowOffset < data.size(); rowOffset += BytesPerRow)
+  {
+    const auto row = data.subspan(
+      rowOffset,
+      std::min(BytesPerRow, data.size() - rowOffset));
+
+    std::string characters;
+    for (std::size_t column = 0; column < BytesPerRow; ++column)
+    {
+      if (column == BytesPerRow / 2)
+      {
+        text += ' ';
+      }
+
+      if (column >= row.size())
+      {
+        text += "   ";
+        continue;
+      }
+
+      const auto value = static_cast<uint8_t>(row[column]);
+      text += ' ';
+      text += HexDigits[value >> 4];
+      text += HexDigits[value & 0xF];
+
+      characters += value >= 32 && value <= 126
+        ? static_cast<char>(value)
+        : '.';
+    }
+
+    text += '\t';
+    text += characters;
+    text += '\n';
+  }
+
+  return text;
+}
+
+} // anon namespace
+
+CommandDumper::CommandDumper(std::string name)
+  : _name(std::move(name))
+{
+  for (uint32_t id = 0; id <= std::numeric_limits<uint16_t>::max(); ++id)
+  {
+    if (!IsCommandMuted(static_cast<CommandId>(id)))
+    {
+      _commandFlags[id / 64] |= uint64_t{1} << id % 64;
+    }
+  }
+
+  _worker = std::jthread(
+    [this](const std::stop_token& stopToken)
+    {
+      Run(stopToken);
+    });
+}
+
+void CommandDumper::SetCommandDumped(CommandId command, bool dumped)
+{
+  const auto id = static_cast<uint16_t>(command);
+  const auto flag = uint64_t{1} << id % 64;
+
+  if (dumped)
+  {
+    _commandFlags[id / 64].fetch_or(flag, std::memory_order_relaxed);
+  }
+  else
+  {
+    _commandFlags[id / 64].fetch_and(~flag, std::memory_order_relaxed);
+  }
+}
+
+void CommandDumper::Dump(
+  ClientId clientId,
+  CommandId command,
+  Direction direction,
+  std::span<const std::byte> data)
+{
+  Enqueue({
+    .direction = direction,
+    .command = command,
+    .clientId = clientId,
+    .recipients = 1,
+    .buffer = std::make_shared<const std::vector<std::byte>>(data.begin(), data.end()),
+    .offset = 0});
+}
+
+void CommandDumper::Dump(
+  std::span<const ClientId> recipients,
+  CommandId command,
+  WriteBuffer buffer,
+  std::size_t offset)
+{
+  if (recipients.empty())
+  {
+    return;
+  }
+
+  Enqueue({
+    .direction = Direction::Sent,
+    .command = command,
+    .clientId = recipients.front(),
+    .recipients = recipients.size(),
+    .buffer = std::move(buffer),
+    .offset = offset});
+}
+
+void CommandDumper::Enqueue(Entry entry)
+{
+  {
+    std::scoped_lock lock(_queueMutex);
+    if (_queue.size() >= MaxQueuedDumps)
+    {
+      ++_droppedDumps;
+      return;
+    }
+
+    _queue.emplace_back(std::move(entry));
+  }
+
+  _queueCondition.notify_one();
+}
+
+void CommandDumper::Run(const std::stop_token& stopToken)
+{
+  std::deque<Entry> entries;
+
+  while (!stopToken.stop_requested())
+  {
+    std::size_t droppedDumps = 0;
+
+    {
+      std::unique_lock lock(_queueMutex);
+      if (!_queueCondition.wait(lock, stopToken, [this]() { return !_queue.empty(); }))
+      {
+        break;
+      }
+
+      std::swap(entries, _queue);
+      std::swap(droppedDumps, _droppedDumps);
+    }
+
+    if (droppedDumps > 0)
+    {
+      spdlog::warn("{} dropped {} command dumps", _name, droppedDumps);
+    }
+
+    for (const auto& entry : entries)
+    {
+      const std::span data = std::span(*entry.buffer).subspan(entry.offset);
+
+      if (entry.direction == Direction::Received)
+      {
+        spdlog::debug("{} received from client {} command '{}' (0x{:X}), Data Size: {}\n{}",
+          _name,
+          entry.clientId,
+          GetCommandName(entry.command),
+          static_cast<uint16_t>(entry.command),
+          data.size(),
+          FormatBytes(data));
+      }
+      else if (entry.recipients == 1)
+      {
+        spdlog::debug("{} sent to client {} command '{}' (0x{:X}), Data Size: {}\n{}",
+          _name,
+          entry.clientId,
+          GetCommandName(entry.command),
+          static_cast<uint16_t>(entry.command),
+          data.size(),
+          FormatBytes(data));
+      }
+      else
+      {
+        spdlog::debug("{} sent to {} clients command '{}' (0x{:X}), Data Size: {}\n{}",
+          _name,
+          entry.recipients,
+          GetCommandName(entry.command),
+          static_cast<uint16_t>(entry.command),
+          data.size(),
+          FormatBytes(data));
+      }
+    }
+
+    entries.clear();
+  }
+}
+
+} // namespace alicia
@@ -19,7 +19,8 @@
 
 #include "libserver/command/CommandProtocol.hpp"
 
-#include <unordered_map>
+#include <array>
+#include <limits>
 
 namespace alicia
 {
@@ -27,95 +28,43 @@ namespace alicia
 namespace
 {
 
-//! Commands IDs mapped to the command names.
-const std::unordered_map<CommandId, std::string_view> commands = {
-  // Login
-  {CommandId::LobbyLogin, "LobbyLogin"},
-  {CommandId::LobbyLoginOK, "LobbyLoginOK"},
-  {CommandId::LobbyLoginCancel, "LobbyLoginCancel"},
-
-  // Heartbeat
-  {CommandId::LobbyHeartbeat, "LobbyHeartbeat"},
-
-  // Inventory
-  {CommandId::LobbyShowInventory, "LobbyShowInventory"},
-  {CommandId::LobbyShowInventoryOK, "LobbyShowInventoryOK"},
-  {CommandId::LobbyShowInventoryCancel, "LobbyShowInventoryCancel"},
-
-  // Inventory
-  {CommandId::LobbyAchievementCompleteList, "LobbyAchievementCompleteList"},
-  {CommandId::LobbyAchievementCompleteListOK, "LobbyAchievementCompleteListOK"},
-  {CommandId::LobbyAchievementCompleteListCancel, "LobbyAchievementCompleteListCancel"},
-
-  // RequestDailyQuestList
-  {CommandId::LobbyRequestDailyQuestList, "RequestDailyQuestList"},
-  {CommandId::LobbyRequestDailyQuestListOK, "RequestDailyQuestListOK"},
-  {CommandId::LobbyRequestDailyQuestListCancel, "RequestDailyQuestListCancel"},
-
-  // RequestLeagueInfo
-  {CommandId::LobbyRequestLeagueInfo, "LobbyRequestLeagueInfo"},
-  {CommandId::LobbyRequestLeagueInfoOK, "LobbyRequestLeagueInfoOK"},
-  {CommandId::LobbyRequestLeagueInfoCancel, "LobbyRequestLeagueInfoCancel"},
-
-  // RequestQuestList
-  {CommandId::LobbyRequestQuestList, "LobbyRequestQuestList"},
-  {CommandId::LobbyRequestQuestListOK, "LobbyRequestQuestListOK"},
-  {CommandId::LobbyRequestQuestListCancel, "LobbyRequestQuestListCancel"},
-
-  // RequestSpecialEventList
-  {CommandId::LobbyRequestSpecialEventList, "LobbyRequestSpecialEventList"},
-  {CommandId::LobbyRequestSpecialEventListOK, "LobbyRequestSpecialEventListOK"},
-
-  // EnterRanch
-  {CommandId::LobbyEnterRanch, "LobbyEnterRanch"},
-  {CommandId::LobbyEnterRanchOK, "LobbyEnterRanchOK"},
-  {CommandId::LobbyEnterRanchCancel, "LobbyEnterRanchCancel"},
-
-  {CommandId::LobbyGetMessengerInfo, "LobbyGetMessengerInfo"},
-  {CommandId::LobbyGetMessengerInfoOK, "LobbyGetMessengerInfoOK"},
-  {CommandId::LobbyGetMessengerInfoCancel, "LobbyGetMessengerInfoCancel"},
-
-  {CommandId::LobbyClientNotify, "LobbyClientNotify"},
-
-  {CommandId::RanchEnterRanch, "RanchEnterRanch"},
-  {CommandId::RanchEnterRanchCancel, "RanchEnterRanchCancel"},
-  {CommandId::RanchEnterRanchNotify, "RanchEnterRanchNotify"},
-  {CommandId::RanchEnterRanchOK, "RanchEnterRanchOK"},
-
-  {CommandId::RanchHeartbeat, "RanchHeartbeat"},
-
-  {CommandId::RanchSnapshot, "RanchSnapshot"},
-  {CommandId::RanchSnapshotNotify, "RanchSnapshotNotify"},
-
-  {CommandId::RanchCmdAction, "RanchCmdAction"},
-  {CommandId::RanchCmdActionNotify, "RanchCmdActionNotify"},
-
-  {CommandId::RanchStuff, "RanchStuff"},
-  {CommandId::RanchStuffOK, "RanchStuffOK"},
-
-  {CommandId::RanchUpdateBusyState, "RanchUpdateBusyState"},
-  {CommandId::RanchUpdateBusyStateNotify, "RanchUpdateBusyStateNotify"},
-
-  {CommandId::RanchSearchStallion, "RanchSearchStallion"},
-  {CommandId::RanchSearchStallionOK, "RanchSearchStallionOK"},
-  {CommandId::RanchSearchStallionCancel, "RanchSearchStallionCancel"},
-
-  {CommandId::RanchEnterBreedingMarket, "RanchEnterBreedingMarket"},
-  {CommandId::RanchEnterBreedingMarketOK, "RanchEnterBreedingMarketOK"},
-  {CommandId::RanchEnterBreedingMarketCancel, "RanchEnterBreedingMarketCancel"},
+//! Metadata of the commands.
+//! The first entry is the metadata of the undefined commands.
+constexpr CommandMeta CommandMetas[] = {
+  CommandMeta{},
+#define COMMAND_META(commandName, id, commandDirection, commandDelivery, commandMuted, commandMaxDataSize) \
+  CommandMeta{                                          \
+    .name = #commandName,                               \
+    .direction = CommandDirection::commandDirection,    \
+    .delivery = CommandDelivery::commandDelivery,       \
+    .muted = commandMuted,                              \
+    .defined = true,                                    \
+    .maxDataSize = commandMaxDataSize},
+  COMMAND_DEFINITIONS(COMMAND_META)
+#undef COMMAND_META
+};
 
-  {CommandId::RanchTryBreeding, "RanchTryBreeding"},
-  {CommandId::RanchTryBreedingOK, "RanchTryBreedingOK"},
-  {CommandId::RanchTryBreedingCancel, "RanchTryBreedingCancel"},
+static_assert(
+  std::size(CommandMetas) <= std::numeric_limits<uint8_t>::max(),
+  "The command metadata index can't address all the commands");
 
-  {CommandId::RanchBreedingWishlist, "RanchBreedingWishlist"},
-  {CommandId::RanchBreedingWishlistCancel, "RanchBreedingWishlistCancel"},
-  {CommandId::RanchBreedingWishlistOK, "RanchBreedingWishlistOK"},
+//! Indices to the command metadata, for every possible command ID.
+constexpr auto CommandMetaIndices = []()
+{
+  constexpr CommandId commandIds[] = {
+#define COMMAND_ENTRY_ID(name, ...) CommandId::name,
+    COMMAND_DEFINITIONS(COMMAND_ENTRY_ID)
+#undef COMMAND_ENTRY_ID
+  };
+
+  std::array<uint8_t, std::numeric_limits<uint16_t>::max() + 1> indices{};
+  for (std::size_t idx = 0; idx < std::size(commandIds); ++idx)
+  {
+    indices[static_cast<uint16_t>(commandIds[idx])] = static_cast<uint8_t>(idx + 1);
+  }
 
-  {CommandId::RanchUpdateMountNickname, "RanchUpdateMountNickname"},
-  {CommandId::RanchUpdateMountNicknameOK, "RanchUpdateMountNicknameOK"},
-  {CommandId::RanchUpdateMountNicknameCancel, "RanchUpdateMountNicknameCancel"},
-};
+  return indices;
+}();
 
 } // namespace anon
 
@@ -148,10 +97,9 @@ uint32_t encode_message_magic(MessageMagic magic)
   return encoded;
 }
 
-std::string_view GetCommandName(CommandId command)
+const CommandMeta& GetCommandMeta(CommandId command)
 {
-  const auto commandIter = commands.find(command);
-  return commandIter == commands.cend() ? "n/a" : commandIter->second;
+  return CommandMetas[CommandMetaIndices[static_cast<uint16_t>(command)]];
 }
 
 } // namespace alicia
@@ -18,6 +18,7 @@
 **/
 
 #include "libserver/command/CommandServer.hpp"
+#include "libserver/command/CommandCodec.hpp"
 #include "libserver/Util.hpp"
 
 #include <spdlog/spdlog.h>
@@ -28,9 +29,6 @@ namespace alicia
 namespace
 {
 
-//! Max size of the command data.
-constexpr std::size_t MaxCommandDataSize = 4092;
-
 //! Flag indicating whether to use the XOR algorithm on recieved data.
 constexpr std::size_t UseXorAlgorithm = true;
 
@@ -38,76 +36,55 @@ constexpr std::size_t UseXorAlgorithm = true;
 //! That is command data size + size of the message magic.
 constexpr std::size_t MaxCommandSize = MaxCommandDataSize + sizeof(MessageMagic);
 
-//! Reads every specified byte of the source stream,
-//! performs XOR operation on that byte with the specified sliding key
-//! and writes the result to the sink stream.
+//! Serializes the command with its message magic.
 //!
-//! @param key Xor Key
-//! @param source Source stream.
-//! @param sink Sink stream.
-void XorAlgorithm(
-  const XorCode& key,
-  SourceStream& source,
-  SinkStream& sink)
+//! @param command ID of the command.
+//! @param supplier Supplier of the command data.
+//! @returns Buffer with the serialized command.
+WriteBuffer SerializeCommand(CommandId command, const CommandSupplier& supplier)
 {
-  for (std::size_t idx = 0; idx < source.Size(); idx++)
-  {
-    const auto shift = idx % 4;
+  // Scratch buffer the commands are serialized to,
+  // before being copied to a buffer of the exact size.
+  thread_local std::array<std::byte, MaxCommandSize> commandBuffer;
 
-    // Read a byte.
-    std::byte v;
-    source.Read(v);
+  SinkStream commandSink(commandBuffer);
 
-    // Xor it with the key.
-    sink.Write(v ^ key[shift]);
-  }
-}
+  const auto streamOrigin = commandSink.GetCursor();
+  commandSink.Seek(streamOrigin + sizeof(MessageMagic));
 
-bool IsMuted(CommandId id)
-{
-  return id == CommandId::LobbyHeartbeat
-      || id == CommandId::RanchHeartbeat
-      || id == CommandId::RanchSnapshot
-      || id == CommandId::RanchSnapshotNotify;
-}
+  // Write the message data.
+  supplier(commandSink);
 
-void LogBytes(std::span<std::byte> data)
-{
-  if(data.size() == 0) {
-    return;
-  }
+  // Payload is the message data size
+  // with the size of the message magic.
+  const uint16_t payloadSize = commandSink.GetCursor();
 
-  char rowString[17];
-  memset(rowString, 0, 17);
+  // Traverse back the stream before the message data,
+  // and write the message magic.
+  commandSink.Seek(streamOrigin);
 
-  int column = 0;
-  for (int i = 0; i < data.size(); ++i) {
-    column = i%16;
+  // Write the message magic.
+  const MessageMagic magic{.id = static_cast<uint16_t>(command), .length = payloadSize};
+  commandSink.Write(encode_message_magic(magic));
 
-    if(i > 0)
-    {
-      switch(column)
-      {
-        case 0:
-          printf("\t%s\n", rowString);
-        memset(rowString, 0, 17);
-        break;
-        case 8:
-          printf(" ");
-        break;
-      }
-    }
-
-    std::byte datum = data[i];
-    if(datum >= std::byte(32) && datum <= std::byte(126)) {
-      rowString[column] = (char)datum;
-    } else {
-      rowString[column] = '.';
-    }
+  return std::make_shared<const std::vector<std::byte>>(
+    commandBuffer.begin(), commandBuffer.begin() + payloadSize);
+}
 
-    printf(" %02X", static_cast<unsigned int>(datum));
+//! Get the key of the write of the command.
+//!
+//! @param command ID of the command.
+//! @param subject Subject of the command.
+//! @returns Key unique to the command and its subject if the command is supersedable,
+//!          zero otherwise.
+WriteKey GetCommandWriteKey(CommandId command, uint32_t subject)
+{
+  if (!IsCommandSupersedable(command))
+  {
+    return 0;
   }
-  printf("%*s\t%s\n\n", (16-column)*3, "", rowString);
+
+  return WriteKey{static_cast<uint16_t>(command)} << 32 | subject;
 }
 
 } // anon namespace
@@ -136,8 +113,20 @@ int32_t CommandClient::GetRollingCodeInt() const
   return *reinterpret_cast<const int32_t*>(_rollingCode.data());
 }
 
-CommandServer::CommandServer(std::string name)
-  : _server(
+void CommandClient::SetDumped(bool dumped)
+{
+  _dumped.store(dumped, std::memory_order_relaxed);
+}
+
+bool CommandClient::IsDumped() const
+{
+  return _dumped.load(std::memory_order_relaxed);
+}
+
+CommandServer::CommandServer(std::string name, IoContextPool& ioContextPool)
+  : _dumper(name)
+  , _server(
+    ioContextPool,
     [this](ClientId clientId)
     {
       HandleClientConnect(clientId);
@@ -148,15 +137,9 @@ CommandServer::CommandServer(std::string name)
     },
     [this](
       ClientId clientId,
-      asio::streambuf& readBuffer)
-    {
-      HandleClientRead(clientId, readBuffer);
-    },
-    [this](
-      ClientId clientId,
-      asio::streambuf& writeBuffer)
+      std::span<std::byte> readBuffer)
     {
-      HandleClientWrite(clientId, writeBuffer);
+      return HandleClientRead(clientId, readBuffer);
     })
 {
   _name = std::move(name);
@@ -164,10 +147,25 @@ CommandServer::CommandServer(std::string name)
 
 void CommandServer::Host(
   const asio::ip::address& address,
-  uint16_t port)
+  uint16_t port,
+  bool reusePort)
+{
+  spdlog::debug("{} server hosted on {}:{}{}",
+    this->_name,
+    address.to_string(),
+    port,
+    reusePort ? " with an acceptor per I/O thread" : "");
+  _server.Host(address, port, reusePort);
+}
+
+void CommandServer::EnableTimeouts(TimingWheel& timingWheel, ClientTimeouts timeouts)
 {
-  spdlog::debug("{} server hosted on {}:{}", this->_name, address.to_string(), port);
-  _server.Host(address, port);
+  _server.EnableTimeouts(timingWheel, timeouts);
+}
+
+void CommandServer::EnableWriteLimits(ClientWriteLimits writeLimits)
+{
+  _server.EnableWriteLimits(writeLimits);
 }
 
 void CommandServer::RegisterCommandHandler(
@@ -179,138 +177,245 @@ void CommandServer::RegisterCommandHandler(
     return;
   }
 
-  _handlers[command] = std::move(handler);
+  // The deque keeps the address of the handler stable.
+  auto& rawHandler = _rawHandlers.emplace_back(std::move(handler));
+  SetCommandHandler(
+    command,
+    {
+      .function = [](void* context, ClientId clientId, SourceStream& source)
+      {
+        (*static_cast<RawCommandHandler*>(context))(clientId, source);
+      },
+      .context = &rawHandler
+    });
+}
+
+void CommandServer::SetCommandHandler(
+  CommandId commandId,
+  CommandHandlerEntry entry)
+{
+  const auto id = static_cast<uint16_t>(commandId);
+
+  auto& page = _handlerPages[id / HandlerPageSize];
+  if (!page)
+  {
+    page = std::make_unique<CommandHandlerPage>();
+  }
+
+  (*page)[id % HandlerPageSize] = entry;
+}
+
+const CommandServer::CommandHandlerEntry* CommandServer::FindCommandHandler(
+  CommandId commandId) const
+{
+  const auto id = static_cast<uint16_t>(commandId);
+
+  const auto& page = _handlerPages[id / HandlerPageSize];
+  if (!page)
+  {
+    return nullptr;
+  }
+
+  const auto& entry = (*page)[id % HandlerPageSize];
+  if (entry.function == nullptr)
+  {
+    return nullptr;
+  }
+
+  return &entry;
+}
+
+void CommandServer::RegisterDisconnectHandler(ClientDisconnectHandler handler)
+{
+  _disconnectHandler = std::move(handler);
 }
 
 void CommandServer::SetCode(ClientId client, XorCode code)
 {
-  _clients[client].SetCode(code);
+  if (auto* commandClient = GetClient(client))
+  {
+    commandClient->SetCode(code);
+  }
 }
 
-void CommandServer::QueueCommand(ClientId client, CommandId command, CommandSupplier supplier)
+void CommandServer::SetCommandDumped(CommandId command, bool dumped)
 {
-  // ToDo: Actual queue.
-  _server.GetClient(client).QueueWrite(
-    [client, command, supplier = std::move(supplier)](asio::streambuf& writeBuffer)
-    {
-      const auto mutableBuffer = writeBuffer.prepare(MaxCommandSize);
-      const auto writeBufferView =
-        std::span(static_cast<std::byte*>(mutableBuffer.data()), mutableBuffer.size());
+  _dumper.SetCommandDumped(command, dumped);
+}
+
+void CommandServer::SetClientDumped(ClientId client, bool dumped)
+{
+  if (auto* commandClient = GetClient(client))
+  {
+    commandClient->SetDumped(dumped);
+  }
+}
 
-      SinkStream commandSink(writeBufferView);
+void CommandServer::QueueCommand(
+  ClientId client,
+  CommandId command,
+  CommandSupplier supplier,
+  uint32_t subject)
+{
+  auto buffer = SerializeCommand(command, supplier);
 
-      const auto streamOrigin = commandSink.GetCursor();
-      commandSink.Seek(streamOrigin + 4);
+  if (_dumper.IsDumped(command) && IsClientDumped(client))
+  {
+    _dumper.Dump({&client, 1}, command, buffer, sizeof(MessageMagic));
+  }
 
-      // Write the message data.
-      supplier(commandSink);
+  _server.QueueWrite(client, std::move(buffer), GetCommandWriteKey(command, subject));
+}
 
-      // Payload is the message data size
-      // with the size of the message magic.
-      const uint16_t payloadSize = commandSink.GetCursor();
+void CommandServer::BroadcastCommand(
+  std::span<const ClientId> clients,
+  CommandId command,
+  CommandSupplier supplier,
+  uint32_t subject)
+{
+  if (clients.empty())
+  {
+    return;
+  }
 
-      // Traverse back the stream before the message data,
-      // and write the message magic.
-      commandSink.Seek(streamOrigin);
+  const auto buffer = SerializeCommand(command, supplier);
 
-      // Write the message magic.
-      const MessageMagic magic{.id = static_cast<uint16_t>(command), .length = payloadSize};
+  // Broadcasts are dumped once, regardless of the dump setting of the clients.
+  if (_dumper.IsDumped(command))
+  {
+    _dumper.Dump(clients, command, buffer, sizeof(MessageMagic));
+  }
 
-      commandSink.Write(encode_message_magic(magic));
-      writeBuffer.commit(magic.length);
+  const WriteKey key = GetCommandWriteKey(command, subject);
+  for (const ClientId client : clients)
+  {
+    _server.QueueWrite(client, buffer, key);
+  }
+}
 
-      if (!IsMuted(command))
-      {
-        spdlog::debug(
-          "Sent to client {} command '{}' (0x{:X}), Data Size: {}",
-          client,
-          GetCommandName(command),
-          magic.id,
-          payloadSize);
-        LogBytes({(std::byte*)mutableBuffer.data() + 4, payloadSize});
-      }
-    });
+CommandClient* CommandServer::GetClient(ClientId clientId)
+{
+  // Pointers to the elements of the map remain valid when other clients are inserted.
+  // The client might have disconnected already, its entry is not recreated.
+  std::scoped_lock lock(_clientsMutex);
+  const auto clientItr = _clients.find(clientId);
+  return clientItr != _clients.cend() ? &clientItr->second : nullptr;
+}
+
+bool CommandServer::IsClientDumped(ClientId clientId)
+{
+  // The client might have disconnected already.
+  std::scoped_lock lock(_clientsMutex);
+  const auto clientItr = _clients.find(clientId);
+  return clientItr != _clients.cend() && clientItr->second.IsDumped();
 }
 
 void CommandServer::HandleClientConnect(ClientId clientId)
 {
   spdlog::info("Client {} connected to {}", clientId, _name);
+
+  std::scoped_lock lock(_clientsMutex);
+  _clients.try_emplace(clientId);
 }
 
 void CommandServer::HandleClientDisconnect(ClientId clientId)
 {
   spdlog::info("Client {} disconnected from {}", clientId, _name);
+
+  if (_disconnectHandler)
+  {
+    _disconnectHandler(clientId);
+  }
+
+  // The ID of the client is not reused, so its state can be released.
+  std::scoped_lock lock(_clientsMutex);
+  _clients.erase(clientId);
 }
 
-void CommandServer::HandleClientRead(
+std::size_t CommandServer::HandleClientRead(
   ClientId clientId,
-  asio::streambuf& readBuffer)
+  std::span<std::byte> readBuffer)
 {
-  SourceStream commandStream({
-    static_cast<const std::byte*>(readBuffer.data().data()),
-    readBuffer.data().size()
-  });
-
-  // Flag indicates whether to consume the bytes
-  // when the read handler exits.
-  bool consumeBytesOnExit = true;
-
-  // Defer the consumption of the bytes from the read buffer,
-  // until the end of the function.
-  const Deferred deferredConsume([&]()
+  auto* client = GetClient(clientId);
+  if (client == nullptr)
   {
-    if (!consumeBytesOnExit)
-      return;
+    throw std::runtime_error(
+      std::format("Client {} is not connected", clientId).c_str());
+  }
+
+  std::size_t consumedSize = 0;
 
-    // Consume the amount of bytes that were
-    // read from the command stream.
-    readBuffer.consume(commandStream.GetCursor());
-  });
+  // Handle every complete command in the buffer.
+  // The commands are handled in the order they were received,
+  // as a handler might change the code used to decode the following commands.
+  while (readBuffer.size() - consumedSize >= sizeof(MessageMagic))
+  {
+    SourceStream commandStream(readBuffer.subspan(consumedSize));
 
-  // Read the message magic.
-  uint32_t magicValue{};
-  commandStream.Read(magicValue);
+    // Read the message magic.
+    uint32_t magicValue{};
+    commandStream.Read(magicValue);
 
-  const MessageMagic magic = decode_message_magic(
-    magicValue);
+    const MessageMagic magic = decode_message_magic(
+      magicValue);
 
-  // Command ID must be within the valid range.
-  if (magic.id > static_cast<uint16_t>(CommandId::Count))
-  {
-    throw std::runtime_error(
-      std::format(
-        "Invalid command magic: Bad command ID '{}'.",
-        magic.id).c_str());
-  }
+    // The provided payload length must be at least the size
+    // of the magic itself and smaller than the max command size.
+    if (magic.length < sizeof(MessageMagic)
+      || magic.length > MaxCommandSize)
+    {
+      throw std::runtime_error(
+        std::format(
+          "Invalid command magic: Bad command data size '{}'.",
+          magic.length).c_str());
+    }
 
-  const auto commandId = static_cast<CommandId>(magic.id);
+    // Size of the data portion of the command.
+    const size_t commandDataSize = static_cast<size_t>(magic.length) - commandStream.GetCursor();
 
-  // The provided payload length must be at least the size
-  // of the magic itself and smaller than the max command size.
-  if (magic.length < sizeof(MessageMagic)
-    || magic.length > MaxCommandSize)
-  {
-    throw std::runtime_error(
-      std::format(
-        "Invalid command magic: Bad command data size '{}'.",
-        magic.length).c_str());
-  }
+    // The command data must fit the size expected for the command,
+    // the commands not defined in the protocol are bound by the metadata of the undefined commands.
+    const auto& commandMeta = GetCommandMeta(
+      static_cast<CommandId>(magic.id));
+    if (commandDataSize > commandMeta.maxDataSize)
+    {
+      throw std::runtime_error(
+        std::format(
+          "Invalid command magic: Bad command data size '{}' for command '{}'.",
+          commandDataSize,
+          commandMeta.name).c_str());
+    }
 
-  // Size of the data portion of the command.
-  const size_t commandDataSize = static_cast<size_t>(magic.length) - commandStream.GetCursor();
+    // If all the required command data are not buffered, keep the partial command
+    // including its magic and wait for the rest of it to arrive.
+    if (commandDataSize > commandStream.Size() - commandStream.GetCursor())
+    {
+      break;
+    }
 
-  // If all the required command data are not buffered,
-  // wait for them to arrive.
-  if (commandDataSize > readBuffer.in_avail())
-  {
-    // Indicate that the bytes read until now
-    // shouldn't be consumed, as we expect more data to arrive.
-    consumeBytesOnExit = false;
+    // The command data are processed directly in the read buffer.
+    HandleCommand(
+      clientId,
+      *client,
+      magic,
+      readBuffer.subspan(consumedSize + commandStream.GetCursor(), commandDataSize));
 
-    return;
+    consumedSize += magic.length;
   }
 
-  if(!IsMuted(commandId))
+  return consumedSize;
+}
+
+void CommandServer::HandleCommand(
+  ClientId clientId,
+  CommandClient& client,
+  const MessageMagic& magic,
+  std::span<std::byte> commandData)
+{
+  const auto commandId = static_cast<CommandId>(magic.id);
+  const size_t commandDataSize = commandData.size();
+
+  if(!IsCommandMuted(commandId))
   {
     spdlog::debug("Received command '{}', ID: 0x{:x}, Length: {},",
       GetCommandName(commandId),
@@ -318,17 +423,8 @@ void CommandServer::HandleClientRead(
       magic.length);
   }
 
-  // Buffer for the command data.
-  std::array<std::byte, MaxCommandDataSize> commandDataBuffer{};
-
-  // Read the command data.
-  commandStream.Read(
-    commandDataBuffer.data(), commandDataSize);
-
   SourceStream commandDataStream(nullptr);
 
-  auto& client = _clients[clientId];
-
   // Validate and process the command data.
   if (commandDataSize > 0)
   {
@@ -354,24 +450,15 @@ void CommandServer::HandleClientRead(
 
       const auto actualCommandDataSize = commandDataSize - padding;
 
-      // Source stream of the command data.
-      SourceStream dataSourceStream(
-        {commandDataBuffer.begin(), commandDataSize});
-      // Sink stream of the command data.
-      // Correctly points to the same buffer.
-      SinkStream dataSinkStream(
-        {commandDataBuffer.begin(), commandDataBuffer.end()});
-
-      // Apply XOR algorithm to the data.
-      XorAlgorithm(
-        client.GetRollingCode(),
-        dataSourceStream,
-        dataSinkStream);
+      // Decode the command data in place.
+      DecodeCommandData(
+        commandData,
+        client.GetRollingCode());
 
       commandDataStream = std::move(SourceStream(
-        {commandDataBuffer.begin(), actualCommandDataSize}));
+        commandData.first(actualCommandDataSize)));
 
-      if(!IsMuted(commandId))
+      if(!IsCommandMuted(commandId))
       {
         spdlog::debug("Data for command '{}' (0x{:X}), Code: {:#X}, Data Size: {} (padding: {}), Actual Data Size: {}",
           GetCommandName(commandId),
@@ -381,31 +468,45 @@ void CommandServer::HandleClientRead(
           padding,
           actualCommandDataSize);
 
-        LogBytes({commandDataBuffer.data(), commandDataSize});
+        if (_dumper.IsDumped(commandId) && client.IsDumped())
+        {
+          _dumper.Dump(
+            clientId,
+            commandId,
+            CommandDumper::Direction::Received,
+            commandData.first(actualCommandDataSize));
+        }
       }
     }
     else
     {
       commandDataStream = std::move(SourceStream(
-        {commandDataBuffer.begin(), commandDataSize}));
+        commandData));
 
-      if(!IsMuted(commandId))
+      if(!IsCommandMuted(commandId))
       {
         spdlog::debug("Data for command '{}' (0x{:X}), Data Size: {}",
           GetCommandName(commandId),
           magic.id,
           commandDataSize);
 
-        LogBytes({commandDataBuffer.data(), commandDataSize});
+        if (_dumper.IsDumped(commandId) && client.IsDumped())
+        {
+          _dumper.Dump(
+            clientId,
+            commandId,
+            CommandDumper::Direction::Received,
+            commandData);
+        }
       }
     }
   }
 
   // Find the handler of the command.
-  const auto handlerIter = _handlers.find(commandId);
-  if (handlerIter == _handlers.cend())
+  const auto handler = FindCommandHandler(commandId);
+  if (handler == nullptr)
   {
-    if(!IsMuted(commandId))
+    if(!IsCommandMuted(commandId))
     {
       spdlog::warn("Unhandled command '{}', ID: 0x{:x}, Length: {}",
         GetCommandName(commandId),
@@ -415,17 +516,13 @@ void CommandServer::HandleClientRead(
   }
   else
   {
-    const auto& handler = handlerIter->second;
-    // Handler validity is checked when registering.
-    assert(handler);
-
     // Call the handler.
-    handler(clientId, commandDataStream);
+    handler->function(handler->context, clientId, commandDataStream);
 
     // There shouldn't be any left-over data in the stream.
     assert(commandDataStream.GetCursor() == commandDataStream.Size());
 
-    if(!IsMuted(commandId))
+    if(!IsCommandMuted(commandId))
     {
       spdlog::debug("Handled command '{}', ID: 0x{:x}, Length: {}",
           GetCommandName(commandId),
@@ -435,11 +532,4 @@ void CommandServer::HandleClientRead(
   }
 }
 
-void CommandServer::HandleClientWrite(
-  ClientId clientId,
-  asio::streambuf& writeBuffer)
-{
-
-}
-
 } // namespace alicia
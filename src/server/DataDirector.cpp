@@ -3,26 +3,26 @@
 //
 
 #include "server/DataDirector.hpp"
+#include "server/storage/DataSnapshot.hpp"
 
 #include <spdlog/spdlog.h>
 
 namespace
 {
 
-//!
+//! Provides the consumer with the access to the value of the datum.
 template<typename T>
-void ProvideLockedDatumAccess(
-  alicia::DataDirector::Datum<T>& datum,
-  const alicia::DatumConsumer<T&>& immutableConsumer)
+void ProvideDatumAccess(
+  alicia::DataDirector::DatumAccess<T> access,
+  const alicia::DatumConsumer<T&>& consumer)
 {
-  std::scoped_lock lock(datum.lock);
   try
   {
-    immutableConsumer(datum.value);
+    consumer(*access);
   }
   catch (const std::exception& x)
   {
-    spdlog::error("Unhandled exception in immutable datum consumer:", x.what());
+    spdlog::error("Unhandled exception in datum consumer: {}", x.what());
   }
 }
 
@@ -31,101 +31,407 @@ void ProvideLockedDatumAccess(
 namespace alicia
 {
 
-DataDirector::DataDirector()
+DataDirector::DataDirector(
+  DataStorage& storage,
+  Settings::DataSettings settings)
+  : _storage(storage)
+  , _settings(std::move(settings))
+  , _users([this](const std::string& name)
+    {
+      return _storage.LoadUser(name);
+    })
+  , _characters([this](DatumUid characterUid)
+    {
+      return _storage.LoadCharacter(characterUid);
+    })
+  , _mounts([this](DatumUid mountUid)
+    {
+      return _storage.LoadMount(mountUid);
+    })
+  , _ranches([this](DatumUid ranchUid)
+    {
+      return _storage.LoadRanch(ranchUid);
+    })
 {
-  _users["rgnt"].value = {
-    .characterUid = 1
-  };
-  _users["laith"].value = {
-    .characterUid = 2
-  };
+  // The flushes continue the sequence of the stored data.
+  _flushSequence = _storage.LoadSequence();
 
-  _characters[1].value = {
-    .nickName = "rgnt",
-    .gender = Gender::Boy,
-    .level = 60,
-    .carrots = 5000,
-    .characterEquipment = {Item{.uid = 100, .tid = 30035, .val = 0, .count = 1}},
-    .mountUid = 3,
-    .ranchUid = 100,
-    .horses = {3}
-  };
-  _characters[2].value = {
-    .nickName = "laith",
-    .gender = Gender::Boy,
-    .level = 60,
-    .carrots = 5000,
-    .characterEquipment = {Item{.uid = 100, .tid = 30035, .val = 0, .count = 1}},
-    .mountUid = 4,
-    .ranchUid = 100,
-    .horses = {4}
-  };
+  if (!_settings.journalPath.empty())
+  {
+    if (_settings.snapshotPath.empty() || _settings.snapshotInterval == 0)
+    {
+      spdlog::warn("The data snapshots are disabled, the data journal won't be compacted");
+    }
+
+    _journal = std::make_unique<DataJournal>(_settings.journalPath);
+    ApplyReplayed(_journal->Replay());
+
+    _journalThread = std::jthread(
+      [this](const std::stop_token& stopToken)
+      {
+        RunJournal(stopToken);
+      });
+  }
+
+  _writeBehindThread = std::jthread(
+    [this](const std::stop_token& stopToken)
+    {
+      RunWriteBehind(stopToken);
+    });
+}
+
+void DataDirector::Flush()
+{
+  std::scoped_lock lock(_flushMutex);
+
+  DataBatch batch{
+    .users = _users.CollectDirty(DirtyTarget::Storage),
+    .characters = _characters.CollectDirty(DirtyTarget::Storage),
+    .mounts = _mounts.CollectDirty(DirtyTarget::Storage),
+    .ranches = _ranches.CollectDirty(DirtyTarget::Storage),
+    .sequence = _flushSequence + 1};
+
+  if (batch.IsEmpty())
+  {
+    return;
+  }
+
+  try
+  {
+    _storage.Store(batch);
+    _flushSequence = batch.sequence;
+  }
+  catch (const std::exception& x)
+  {
+    spdlog::error("Couldn't store the data, retrying with the next flush: {}", x.what());
+
+    // Keep the data dirty to retry with the next flush.
+    MarkBatchDirty(batch, DirtyTarget::Storage);
+  }
+}
+
+void DataDirector::CommitJournal()
+{
+  if (!_journal)
+  {
+    return;
+  }
+
+  std::scoped_lock lock(_journalMutex);
+
+  DataBatch batch{
+    .users = _users.CollectDirty(DirtyTarget::Journal),
+    .characters = _characters.CollectDirty(DirtyTarget::Journal),
+    .mounts = _mounts.CollectDirty(DirtyTarget::Journal),
+    .ranches = _ranches.CollectDirty(DirtyTarget::Journal)};
+
+  if (batch.IsEmpty())
+  {
+    return;
+  }
+
+  try
+  {
+    _journal->Append(batch);
+  }
+  catch (const std::exception& x)
+  {
+    spdlog::error("Couldn't append to the data journal, retrying with the next commit: {}", x.what());
+
+    // Keep the data dirty to retry with the next commit.
+    MarkBatchDirty(batch, DirtyTarget::Journal);
+  }
+}
+
+void DataDirector::WriteSnapshot(const std::filesystem::path& path)
+{
+  // The data not stored by the flushes up to the sequence
+  // are stored by the later flushes, after they are read to the snapshot.
+  uint64_t sequence = 0;
+  {
+    std::scoped_lock lock(_flushMutex);
+    sequence = _flushSequence;
+  }
+
+  DataSnapshotWriter writer(path, sequence);
+
+  _users.ForEach([&writer](const std::string& name, const User& user)
+  {
+    writer.Write(name, user);
+  });
+  _characters.ForEach([&writer](DatumUid characterUid, const User::Character& character)
+  {
+    writer.Write(characterUid, character);
+  });
+  _mounts.ForEach([&writer](DatumUid mountUid, const User::Mount& mount)
+  {
+    writer.Write(mountUid, mount);
+  });
+  _ranches.ForEach([&writer](DatumUid ranchUid, const User::Ranch& ranch)
+  {
+    writer.Write(ranchUid, ranch);
+  });
+
+  writer.Commit();
+}
+
+void DataDirector::RunWriteBehind(const std::stop_token& stopToken)
+{
+  const std::chrono::milliseconds writeBehindInterval(_settings.writeBehindInterval);
+  const std::chrono::seconds snapshotInterval(_settings.snapshotInterval);
+  const bool isSnapshotEnabled = !_settings.snapshotPath.empty()
+    && snapshotInterval.count() != 0;
+
+  auto lastSnapshotTime = std::chrono::steady_clock::now();
+
+  while (!stopToken.stop_requested())
+  {
+    {
+      std::unique_lock lock(_writeBehindMutex);
+      _writeBehindCondition.wait_for(
+        lock,
+        stopToken,
+        writeBehindInterval,
+        []()
+        {
+          return false;
+        });
+    }
+
+    Flush();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!isSnapshotEnabled
+      || (now - lastSnapshotTime < snapshotInterval && !stopToken.stop_requested()))
+    {
+      continue;
+    }
+
+    lastSnapshotTime = now;
+    try
+    {
+      CompactSnapshot();
+    }
+    catch (const std::exception& x)
+    {
+      spdlog::error("Couldn't write the data snapshot: {}", x.what());
+    }
+  }
+}
+
+void DataDirector::RunJournal(const std::stop_token& stopToken)
+{
+  const std::chrono::milliseconds journalInterval(_settings.journalInterval);
+
+  while (!stopToken.stop_requested())
+  {
+    {
+      std::unique_lock lock(_journalWaitMutex);
+      _journalCondition.wait_for(
+        lock,
+        stopToken,
+        journalInterval,
+        [this]()
+        {
+          return _isJournalBatchPending;
+        });
+      _isJournalBatchPending = false;
+    }
 
-  _mounts[3].value = {
-    .tid = 0x4E21, .name = "idontunderstand"
-  };
-  _mounts[4].value = {
-    .tid = 0x4E21, .name = "Ramon"
-  };
+    CommitJournal();
+  }
+}
 
-  _ranches[100].value = {
-    .ranchName = "SoA Ranch"
-  };
+void DataDirector::CompactSnapshot()
+{
+  if (_journal)
+  {
+    // The records of the rotated journal are older than the snapshot.
+    std::scoped_lock lock(_journalMutex);
+    _journal->Rotate();
+  }
+
+  WriteSnapshot(_settings.snapshotPath);
+
+  // The snapshot is durable once written, the rotated journal is no longer needed.
+  if (_journal)
+  {
+    _journal->DiscardRotated();
+  }
 }
 
+void DataDirector::ApplyReplayed(DataBatch batch)
+{
+  // The replayed data might be newer than the storage.
+  for (auto& [name, user] : batch.users)
+  {
+    _users.Put(name, std::move(user));
+    _users.MarkDirty(name, DirtyTarget::Storage);
+  }
+  for (auto& [characterUid, character] : batch.characters)
+  {
+    _characters.Put(characterUid, std::move(character));
+    _characters.MarkDirty(characterUid, DirtyTarget::Storage);
+  }
+  for (auto& [mountUid, mount] : batch.mounts)
+  {
+    _mounts.Put(mountUid, std::move(mount));
+    _mounts.MarkDirty(mountUid, DirtyTarget::Storage);
+  }
+  for (auto& [ranchUid, ranch] : batch.ranches)
+  {
+    _ranches.Put(ranchUid, std::move(ranch));
+    _ranches.MarkDirty(ranchUid, DirtyTarget::Storage);
+  }
+}
 
-void DataDirector::GetUser(const std::string& name, DatumConsumer<User&> consumer)
+void DataDirector::MarkBatchDirty(const DataBatch& batch, DirtyTarget target)
 {
-  consumer(_users[name].value);
+  for (const auto& [name, user] : batch.users)
+  {
+    _users.MarkDirty(name, target);
+  }
+  for (const auto& [characterUid, character] : batch.characters)
+  {
+    _characters.MarkDirty(characterUid, target);
+  }
+  for (const auto& [mountUid, mount] : batch.mounts)
+  {
+    _mounts.MarkDirty(mountUid, target);
+  }
+  for (const auto& [ranchUid, ranch] : batch.ranches)
+  {
+    _ranches.MarkDirty(ranchUid, target);
+  }
 }
 
-DataDirector::DatumAccess<User> DataDirector::GetUser(
+template<typename Key, typename Val>
+void DataDirector::MarkModified(DatumStore<Key, Val>& store, const Key& key)
+{
+  store.MarkDirty(key, DirtyTarget::Storage);
+
+  if (!_journal)
+  {
+    return;
+  }
+
+  // Commit the journal early once a batch of the data is modified.
+  if (store.MarkDirty(key, DirtyTarget::Journal) >= _settings.journalBatchSize)
+  {
+    {
+      std::scoped_lock lock(_journalWaitMutex);
+      _isJournalBatchPending = true;
+    }
+    _journalCondition.notify_one();
+  }
+}
+
+void DataDirector::GetUser(
+  const std::string& name,
+  DatumConsumer<const User&> consumer)
+{
+  ProvideDatumAccess(GetUser(name), consumer);
+}
+
+DataDirector::DatumAccess<const User> DataDirector::GetUser(
+  const std::string& name)
+{
+  auto& datum = _users.Find(name);
+  return {datum.value, datum.lock};
+}
+
+DataDirector::DatumAccess<User> DataDirector::GetUserMutable(
   const std::string& name)
 {
-  auto& datum = _users[name];
-  return DatumAccess(datum);
+  auto& datum = _users.Find(name);
+  DatumAccess<User> access(datum.value, datum.lock);
+
+  MarkModified(_users, name);
+  return access;
 }
 
 void DataDirector::GetCharacter(
   DatumUid characterUid,
-  DatumConsumer<User::Character&> consumer)
+  DatumConsumer<const User::Character&> consumer)
+{
+  ProvideDatumAccess(GetCharacter(characterUid), consumer);
+}
+
+DataDirector::DatumAccess<const User::Character> DataDirector::GetCharacter(
+  DatumUid characterUid)
 {
-  ProvideLockedDatumAccess(_characters[characterUid], consumer);
+  auto& datum = _characters.Find(characterUid);
+  return {datum.value, datum.lock};
 }
 
-DataDirector::DatumAccess<User::Character> DataDirector::GetCharacter(
+DataDirector::DatumAccess<User::Character> DataDirector::GetCharacterMutable(
   DatumUid characterUid)
 {
-  auto& datum = _characters[characterUid];
-  return DatumAccess(datum);
+  auto& datum = _characters.Find(characterUid);
+  DatumAccess<User::Character> access(datum.value, datum.lock);
+
+  MarkModified(_characters, characterUid);
+  return access;
+}
+
+DataDirector::DatumBatchAccess<User::Character> DataDirector::GetCharacters(
+  std::span<const DatumUid> characterUids)
+{
+  return _characters.FindMany(characterUids);
 }
 
 void DataDirector::GetMount(
   DatumUid mountUid,
-  DatumConsumer<User::Mount&> consumer)
+  DatumConsumer<const User::Mount&> consumer)
+{
+  ProvideDatumAccess(GetMount(mountUid), consumer);
+}
+
+DataDirector::DatumAccess<const User::Mount> DataDirector::GetMount(
+  DatumUid mountUid)
 {
-  ProvideLockedDatumAccess(_mounts[mountUid], consumer);
+  auto& datum = _mounts.Find(mountUid);
+  return {datum.value, datum.lock};
 }
 
-DataDirector::DatumAccess<User::Mount> DataDirector::GetMount(
+DataDirector::DatumAccess<User::Mount> DataDirector::GetMountMutable(
   DatumUid mountUid)
 {
-  auto& datum = _mounts[mountUid];
-  return DatumAccess(datum);
+  auto& datum = _mounts.Find(mountUid);
+  DatumAccess<User::Mount> access(datum.value, datum.lock);
+
+  MarkModified(_mounts, mountUid);
+  return access;
+}
+
+DataDirector::DatumBatchAccess<User::Mount> DataDirector::GetMounts(
+  std::span<const DatumUid> mountUids)
+{
+  return _mounts.FindMany(mountUids);
 }
 
 void DataDirector::GetRanch(
   DatumUid ranchUid,
-  DatumConsumer<User::Ranch&> consumer)
+  DatumConsumer<const User::Ranch&> consumer)
+{
+  ProvideDatumAccess(GetRanch(ranchUid), consumer);
+}
+
+DataDirector::DatumAccess<const User::Ranch> DataDirector::GetRanch(
+  DatumUid ranchUid)
 {
-  ProvideLockedDatumAccess(_ranches[ranchUid], consumer);
+  auto& datum = _ranches.Find(ranchUid);
+  return {datum.value, datum.lock};
 }
 
-DataDirector::DatumAccess<User::Ranch> DataDirector::GetRanch(
+DataDirector::DatumAccess<User::Ranch> DataDirector::GetRanchMutable(
   DatumUid ranchUid)
 {
-  auto& datum = _ranches[ranchUid];
-  return DatumAccess(datum);
+  auto& datum = _ranches.Find(ranchUid);
+  DatumAccess<User::Ranch> access(datum.value, datum.lock);
+
+  MarkModified(_ranches, ranchUid);
+  return access;
 }
 
 } // namespace alicia
@@ -39,8 +39,6 @@ struct User
   HorseId mountUid{};
   std::vector<HorseId> horses{};
 
-  std::chrono::system_clock::time_point lastHeartbeat;
-
   RanchId ranchUid{};
 };
 
@@ -72,6 +72,35 @@ void Settings::LoadFromFile(const std::filesystem::path& filePath)
           }
         }
       }
+
+      if (lobby.contains("reusePort"))
+      {
+        _lobbySettings.reusePort = lobby["reusePort"].get<bool>();
+      }
+      if (lobby.contains("handshakeTimeout"))
+      {
+        _lobbySettings.handshakeTimeout = lobby["handshakeTimeout"].get<uint32_t>();
+      }
+      if (lobby.contains("idleTimeout"))
+      {
+        _lobbySettings.idleTimeout = lobby["idleTimeout"].get<uint32_t>();
+      }
+      if (lobby.contains("writeHighWatermark"))
+      {
+        _lobbySettings.writeHighWatermark = lobby["writeHighWatermark"].get<uint32_t>();
+      }
+      if (lobby.contains("writeLowWatermark"))
+      {
+        _lobbySettings.writeLowWatermark = lobby["writeLowWatermark"].get<uint32_t>();
+      }
+      if (lobby.contains("writeQueueLimit"))
+      {
+        _lobbySettings.writeQueueLimit = lobby["writeQueueLimit"].get<uint32_t>();
+      }
+      if (lobby.contains("writeStallTimeout"))
+      {
+        _lobbySettings.writeStallTimeout = lobby["writeStallTimeout"].get<uint32_t>();
+      }
     }
     // Extract ranch settings
     if (jsonConfig.contains("ranch"))
@@ -87,6 +116,43 @@ void Settings::LoadFromFile(const std::filesystem::path& filePath)
           _ranchSettings.port = port;
         }
       }
+      if (ranch.contains("tickRate"))
+      {
+        const auto tickRate = ranch["tickRate"].get<uint32_t>();
+        // Tick rate must be at least 1 Hz.
+        if (tickRate != 0)
+        {
+          _ranchSettings.tickRate = tickRate;
+        }
+      }
+      if (ranch.contains("reusePort"))
+      {
+        _ranchSettings.reusePort = ranch["reusePort"].get<bool>();
+      }
+      if (ranch.contains("handshakeTimeout"))
+      {
+        _ranchSettings.handshakeTimeout = ranch["handshakeTimeout"].get<uint32_t>();
+      }
+      if (ranch.contains("idleTimeout"))
+      {
+        _ranchSettings.idleTimeout = ranch["idleTimeout"].get<uint32_t>();
+      }
+      if (ranch.contains("writeHighWatermark"))
+      {
+        _ranchSettings.writeHighWatermark = ranch["writeHighWatermark"].get<uint32_t>();
+      }
+      if (ranch.contains("writeLowWatermark"))
+      {
+        _ranchSettings.writeLowWatermark = ranch["writeLowWatermark"].get<uint32_t>();
+      }
+      if (ranch.contains("writeQueueLimit"))
+      {
+        _ranchSettings.writeQueueLimit = ranch["writeQueueLimit"].get<uint32_t>();
+      }
+      if (ranch.contains("writeStallTimeout"))
+      {
+        _ranchSettings.writeStallTimeout = ranch["writeStallTimeout"].get<uint32_t>();
+      }
     }
     // Extract messenger settings
     if (jsonConfig.contains("messenger"))
@@ -103,6 +169,126 @@ void Settings::LoadFromFile(const std::filesystem::path& filePath)
         }
       }
     }
+    // Extract network settings
+    if (jsonConfig.contains("network"))
+    {
+      const auto& network = jsonConfig["network"];
+      if (network.contains("ioThreads"))
+      {
+        _networkSettings.ioThreads = network["ioThreads"].get<uint32_t>();
+      }
+      if (network.contains("timerTickInterval"))
+      {
+        const auto timerTickInterval = network["timerTickInterval"].get<uint32_t>();
+        // The tick interval must be at least 1 millisecond.
+        if (timerTickInterval != 0)
+        {
+          _networkSettings.timerTickInterval = timerTickInterval;
+        }
+      }
+    }
+    // Extract logging settings
+    if (jsonConfig.contains("logging"))
+    {
+      const auto& logging = jsonConfig["logging"];
+      if (logging.contains("level"))
+      {
+        _loggingSettings.level = logging["level"].get<std::string>();
+      }
+      if (logging.contains("queueSize"))
+      {
+        const auto queueSize = logging["queueSize"].get<uint32_t>();
+        if (queueSize != 0)
+        {
+          _loggingSettings.queueSize = queueSize;
+        }
+      }
+      if (logging.contains("threadCount"))
+      {
+        const auto threadCount = logging["threadCount"].get<uint32_t>();
+        if (threadCount != 0)
+        {
+          _loggingSettings.threadCount = threadCount;
+        }
+      }
+      if (logging.contains("overflowPolicy"))
+      {
+        const auto overflowPolicy = logging["overflowPolicy"].get<std::string>();
+        if (overflowPolicy == "block")
+        {
+          _loggingSettings.overflowPolicy = LoggingSettings::OverflowPolicy::Block;
+        }
+        else if (overflowPolicy == "overrunOldest")
+        {
+          _loggingSettings.overflowPolicy = LoggingSettings::OverflowPolicy::OverrunOldest;
+        }
+        else
+        {
+          spdlog::warn("Unknown log overflow policy '{}'", overflowPolicy);
+        }
+      }
+    }
+    // Extract data settings
+    if (jsonConfig.contains("data"))
+    {
+      const auto& data = jsonConfig["data"];
+      if (data.contains("storage"))
+      {
+        const auto storage = data["storage"].get<std::string>();
+        if (storage == "memory")
+        {
+          _dataSettings.storage = DataSettings::Storage::Memory;
+        }
+        else if (storage == "postgres")
+        {
+          _dataSettings.storage = DataSettings::Storage::Postgres;
+        }
+        else
+        {
+          spdlog::warn("Unknown data storage '{}'", storage);
+        }
+      }
+      if (data.contains("connectionString"))
+      {
+        _dataSettings.connectionString = data["connectionString"].get<std::string>();
+      }
+      if (data.contains("writeBehindInterval"))
+      {
+        const auto writeBehindInterval = data["writeBehindInterval"].get<uint32_t>();
+        if (writeBehindInterval != 0)
+        {
+          _dataSettings.writeBehindInterval = writeBehindInterval;
+        }
+      }
+      if (data.contains("snapshotPath"))
+      {
+        _dataSettings.snapshotPath = data["snapshotPath"].get<std::string>();
+      }
+      if (data.contains("snapshotInterval"))
+      {
+        _dataSettings.snapshotInterval = data["snapshotInterval"].get<uint32_t>();
+      }
+      if (data.contains("journalPath"))
+      {
+        _dataSettings.journalPath = data["journalPath"].get<std::string>();
+      }
+      if (data.contains("journalInterval"))
+      {
+        const auto journalInterval = data["journalInterval"].get<uint32_t>();
+        if (journalInterval != 0)
+        {
+          _dataSettings.journalInterval = journalInterval;
+        }
+      }
+      if (data.contains("journalBatchSize"))
+      {
+        const auto journalBatchSize = data["journalBatchSize"].get<uint32_t>();
+        if (journalBatchSize != 0)
+        {
+          _dataSettings.journalBatchSize = journalBatchSize;
+        }
+      }
+    }
   }
   catch (const nlohmann::json::parse_error& e)
   {
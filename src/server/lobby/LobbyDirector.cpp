@@ -21,93 +21,83 @@ namespace alicia
 
 LobbyDirector::LobbyDirector(
   DataDirector& dataDirector,
+  IoContextPool& ioContextPool,
+  TimingWheel& timingWheel,
   Settings::LobbySettings settings)
   : _settings(std::move(settings))
   , _dataDirector(dataDirector)
   , _loginHandler(dataDirector)
-  , _server("Lobby")
+  , _server("Lobby", ioContextPool)
 {
   // Handlers
 
   // Login handler
-  _server.RegisterCommandHandler<LobbyCommandLogin>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleUserLogin>(
     CommandId::LobbyLogin,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleUserLogin(clientId, message);
-    });
+    this);
 
   // Heartbeat handler
-  _server.RegisterCommandHandler<LobbyCommandHeartbeat>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleHeartbeat>(
     CommandId::LobbyHeartbeat,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleHeartbeat(clientId, message);
-    });
+    this);
 
   // ShowInventory handler
-  _server.RegisterCommandHandler<LobbyCommandShowInventory>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleShowInventory>(
     CommandId::LobbyShowInventory,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleShowInventory(clientId, message);
-    });
+    this);
 
   // AchievementCompleteList handler
-  _server.RegisterCommandHandler<LobbyCommandAchievementCompleteList>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleAchievementCompleteList>(
     CommandId::LobbyAchievementCompleteList,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleAchievementCompleteList(clientId, message);
-    });
+    this);
 
   // RequestLeagueInfo
-  _server.RegisterCommandHandler<LobbyCommandRequestLeagueInfo>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleRequestLeagueInfo>(
     CommandId::LobbyRequestLeagueInfo,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleRequestLeagueInfo(clientId, message);
-    });
+    this);
 
   // RequestQuestList handler
-  _server.RegisterCommandHandler<LobbyCommandRequestQuestList>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleRequestQuestList>(
     CommandId::LobbyRequestQuestList,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleRequestQuestList(clientId, message);
-    });
+    this);
 
   // RequestSpecialEventList
-  _server.RegisterCommandHandler<LobbyCommandRequestSpecialEventList>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleRequestSpecialEventList>(
     CommandId::LobbyRequestSpecialEventList,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleRequestSpecialEventList(clientId, message);
-    });
+    this);
 
   // EnterRanch
-  _server.RegisterCommandHandler<LobbyCommandEnterRanch>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleEnterRanch>(
     CommandId::LobbyEnterRanch,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleEnterRanch(clientId, message);
-    });
+    this);
 
   // GetMessengerInfo
-  _server.RegisterCommandHandler<LobbyCommandGetMessengerInfo>(
+  _server.RegisterCommandHandler<&LobbyDirector::HandleGetMessengerInfo>(
     CommandId::LobbyGetMessengerInfo,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleGetMessengerInfo(clientId, message);
-    });
+    this);
 
   spdlog::debug("Advertising ranch server on {}:{}",
     _settings.ranchAdvAddress.to_string(), _settings.ranchAdvPort);
   spdlog::debug("Advertising messenger server on {}:{}",
     _settings.messengerAdvAddress.to_string(), _settings.messengerAdvPort);
 
+  // Disconnect the clients which don't send the commands in time.
+  _server.EnableTimeouts(
+    timingWheel,
+    {
+      .handshake = std::chrono::seconds(_settings.handshakeTimeout),
+      .idle = std::chrono::seconds(_settings.idleTimeout),
+      .stall = std::chrono::seconds(_settings.writeStallTimeout)
+    });
+
+  // Bound the data queued to the clients which don't keep up with them.
+  _server.EnableWriteLimits({
+    .highWatermark = _settings.writeHighWatermark,
+    .lowWatermark = _settings.writeLowWatermark,
+    .maxQueuedSize = _settings.writeQueueLimit});
+
   // Host the server.
-  _server.Host(_settings.address, _settings.port);
+  _server.Host(_settings.address, _settings.port, _settings.reusePort);
 }
 
 void LobbyDirector::HandleUserLogin(ClientId clientId, const LobbyCommandLogin& login)
@@ -115,6 +105,7 @@ void LobbyDirector::HandleUserLogin(ClientId clientId, const LobbyCommandLogin&
   assert(login.constant0 == 50);
   assert(login.constant1 == 281);
 
+  std::unique_lock clientsLock(_clientsMutex);
   if (_queuedClientLogins.contains(clientId))
   {
     spdlog::warn(
@@ -123,6 +114,7 @@ void LobbyDirector::HandleUserLogin(ClientId clientId, const LobbyCommandLogin&
       clientId);
     return;
   }
+  clientsLock.unlock();
 
   // Authenticate the user.
   if (!_loginHandler.Authenticate(login.loginId, login.authKey))
@@ -162,7 +154,10 @@ void LobbyDirector::HandleUserLogin(ClientId clientId, const LobbyCommandLogin&
   const auto mount = _dataDirector.GetMount(
     character->mountUid);
 
-  _clientCharacters[clientId] = user->characterUid;
+  {
+    std::scoped_lock lock(_clientsMutex);
+    _clientCharacters[clientId] = user->characterUid;
+  }
 
   const WinFileTime time = UnixTimeToFileTime(
     std::chrono::system_clock::now());
@@ -325,15 +320,7 @@ void LobbyDirector::HandleHeartbeat(
   ClientId clientId,
   const LobbyCommandHeartbeat& heartbeat)
 {
-  // Todo
-  // auto userItr = _clientUsers.find(clientId);
-  // if (userItr == _clientUsers.cend())
-  // {
-  //   return;
-  // }
-  //
-  // auto& [userId, user] = *_users.find(userItr->second);
-  // user.lastHeartbeat = std::chrono::system_clock::now();
+  // The heartbeat, as any other command, extends the idle timeout of the client.
 }
 
 void LobbyDirector::HandleShowInventory(
@@ -412,7 +399,11 @@ void LobbyDirector::HandleEnterRanch(
   ClientId clientId,
   const LobbyCommandEnterRanch& enterRanch)
 {
-  const auto [_, characterUid] = *_clientCharacters.find(clientId);
+  DatumUid characterUid;
+  {
+    std::scoped_lock lock(_clientsMutex);
+    characterUid = _clientCharacters.find(clientId)->second;
+  }
 
   _server.QueueCommand(
     clientId,
@@ -3,30 +3,127 @@
 #include "server/lobby/LobbyDirector.hpp"
 #include "server/ranch/RanchDirector.hpp"
 
+#include <libserver/base/IoContextPool.hpp>
 #include <libserver/base/Server.hpp>
+#include <libserver/base/TimingWheel.hpp>
 #include <libserver/command/CommandServer.hpp>
 #include <libserver/Util.hpp>
 #include <server/Settings.hpp>
+#include <server/storage/DataSnapshot.hpp>
+#include <server/storage/MemoryDataStorage.hpp>
 
+#ifdef ALICIA_WITH_POSTGRES
+#include <server/storage/PostgresDataStorage.hpp>
+#endif
+
+#include <spdlog/async.h>
 #include <spdlog/sinks/daily_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 #include <memory>
-#include <thread>
 
 #include <iostream>
 namespace
 {
 
+std::unique_ptr<alicia::IoContextPool> g_ioContextPool;
+std::unique_ptr<alicia::TimingWheel> g_timingWheel;
+std::unique_ptr<alicia::DataStorage> g_dataStorage;
+std::unique_ptr<alicia::DataStorage> g_snapshotStorage;
 std::unique_ptr<alicia::DataDirector> g_dataDirector;
 std::unique_ptr<alicia::LobbyDirector> g_loginDirector;
 std::unique_ptr<alicia::RanchDirector> g_ranchDirector;
 
+//! Interval of the reports of the dropped log messages.
+constexpr auto LogOverrunReportInterval = std::chrono::seconds(10);
+
+//! Periodically reports the number of the log messages
+//! dropped because of the full log queue.
+//!
+//! @param timer Timer of the reports.
+//! @param reportedCount Number of the dropped messages already reported.
+void ReportLogOverruns(boost::asio::steady_timer& timer, std::size_t reportedCount)
+{
+  const std::size_t overrunCount = spdlog::thread_pool()->overrun_counter();
+  if (overrunCount > reportedCount)
+  {
+    spdlog::warn(
+      "Dropped {} log messages, the log queue is full",
+      overrunCount - reportedCount);
+  }
+
+  timer.expires_after(LogOverrunReportInterval);
+  timer.async_wait(
+    [&timer, overrunCount](const boost::system::error_code& error)
+    {
+      if (error)
+      {
+        return;
+      }
+
+      ReportLogOverruns(timer, overrunCount);
+    });
+}
+
+//! Creates the memory data storage with the development data.
+std::unique_ptr<alicia::DataStorage> CreateMemoryDataStorage()
+{
+  auto storage = std::make_unique<alicia::MemoryDataStorage>();
+
+  alicia::DataBatch batch;
+  batch.users = {
+    {"rgnt", {._token = "", .characterUid = 1}},
+    {"laith", {._token = "", .characterUid = 2}}};
+  batch.characters = {
+    {1, {
+      .nickName = "rgnt",
+      .gender = alicia::Gender::Boy,
+      .level = 60,
+      .carrots = 5000,
+      .status = "",
+      .characterEquipment = {alicia::Item{.uid = 100, .tid = 30035, .val = 0, .count = 1}},
+      .horseEquipment = {},
+      .mountUid = 3,
+      .ranchUid = 100,
+      .horses = {3}}},
+    {2, {
+      .nickName = "laith",
+      .gender = alicia::Gender::Boy,
+      .level = 60,
+      .carrots = 5000,
+      .status = "",
+      .characterEquipment = {alicia::Item{.uid = 100, .tid = 30035, .val = 0, .count = 1}},
+      .horseEquipment = {},
+      .mountUid = 4,
+      .ranchUid = 100,
+      .horses = {4}}}};
+  batch.mounts = {
+    {3, {.tid = 0x4E21, .name = "idontunderstand"}},
+    {4, {.tid = 0x4E21, .name = "Ramon"}}};
+  batch.ranches = {
+    {100, {.ranchName = "SoA Ranch"}}};
+
+  storage->Store(batch);
+  return storage;
+}
+
 } // namespace
 
 int main()
 {
+  // Parsing settings file
+  alicia::Settings settings;
+  settings.LoadFromFile("resources/settings.json");
+
+  const auto& loggingSettings = settings._loggingSettings;
+
+  // The messages are queued by the logging threads,
+  // and written to the sinks by the threads of the log thread pool.
+  spdlog::init_thread_pool(
+    loggingSettings.queueSize,
+    loggingSettings.threadCount);
+
   // Daily file sink.
   const auto fileSink = std::make_shared<spdlog::sinks::daily_file_sink_mt>("logs/log.log", 0, 0);
 
@@ -34,11 +131,15 @@ int main()
   const auto consoleSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
 
   // Initialize the application logger with file sink and console sink.
-  auto applicationLogger = std::make_shared<spdlog::logger>(
+  auto applicationLogger = std::make_shared<spdlog::async_logger>(
     "abc",
-    spdlog::sinks_init_list{fileSink, consoleSink});
+    spdlog::sinks_init_list{fileSink, consoleSink},
+    spdlog::thread_pool(),
+    loggingSettings.overflowPolicy == alicia::Settings::LoggingSettings::OverflowPolicy::Block
+      ? spdlog::async_overflow_policy::block
+      : spdlog::async_overflow_policy::overrun_oldest);
 
-  applicationLogger->set_level(spdlog::level::debug);
+  applicationLogger->set_level(spdlog::level::from_str(loggingSettings.level));
   applicationLogger->set_pattern("%H:%M:%S:%e [%^%l%$] [Thread %t] %v");
 
   // Set is as the default logger for the application.
@@ -46,38 +147,81 @@ int main()
 
   spdlog::info("Running Alicia server v{}.", alicia::BuildVersion);
 
-  // Parsing settings file
-  alicia::Settings settings;
-  settings.LoadFromFile("resources/settings.json");
-
-  g_dataDirector = std::make_unique<alicia::DataDirector>();
-
-  // Lobby director thread.
-  std::jthread lobbyThread(
-    [&settings]()
+  const auto& dataSettings = settings._dataSettings;
+  if (dataSettings.storage == alicia::Settings::DataSettings::Storage::Postgres)
+  {
+#ifdef ALICIA_WITH_POSTGRES
+    g_dataStorage = std::make_unique<alicia::PostgresDataStorage>(
+      dataSettings.connectionString);
+#else
+    spdlog::critical("The server was built without the PostgreSQL data storage");
+    return 1;
+#endif
+  }
+  else
+  {
+    spdlog::warn("Using the memory data storage, the data are lost on exit");
+    g_dataStorage = CreateMemoryDataStorage();
+  }
+
+  // Warm up from the snapshot, while the data storage catches up.
+  if (!dataSettings.snapshotPath.empty()
+    && std::filesystem::exists(dataSettings.snapshotPath))
+  {
+    try
     {
-      g_loginDirector = std::make_unique<alicia::LobbyDirector>(
-        *g_dataDirector,
-        settings._lobbySettings);
-    });
-
-  // Ranch director thread.
-  std::jthread ranchThread(
-    [&settings]()
+      g_snapshotStorage = std::make_unique<alicia::SnapshotDataStorage>(
+        dataSettings.snapshotPath,
+        *g_dataStorage);
+    }
+    catch (const std::exception& x)
     {
-      g_ranchDirector = std::make_unique<alicia::RanchDirector>(
-        *g_dataDirector,
-        settings._ranchSettings);
-    });
-
-  // Messenger thread.
-  std::jthread messengerThread(
-    [&settings]()
-    {
-      alicia::CommandServer messengerServer("Messenger");
-      // TODO: Messenger
-      messengerServer.Host(boost::asio::ip::address_v4::any(), 10032);
-    });
+      // The data are loaded from the storage without the snapshot.
+      spdlog::warn("Couldn't use the data snapshot: {}", x.what());
+    }
+  }
+
+  g_dataDirector = std::make_unique<alicia::DataDirector>(
+    g_snapshotStorage ? *g_snapshotStorage : *g_dataStorage,
+    dataSettings);
+
+  // I/O context pool shared by all the hosts.
+  g_ioContextPool = std::make_unique<alicia::IoContextPool>(
+    settings._networkSettings.ioThreads);
+
+  // Timing wheel tracking the timeouts of the clients of all the hosts.
+  g_timingWheel = std::make_unique<alicia::TimingWheel>(
+    g_ioContextPool->GetContext(),
+    std::chrono::milliseconds(settings._networkSettings.timerTickInterval));
+
+  // Lobby director.
+  g_loginDirector = std::make_unique<alicia::LobbyDirector>(
+    *g_dataDirector,
+    *g_ioContextPool,
+    *g_timingWheel,
+    settings._lobbySettings);
+
+  // Ranch director.
+  g_ranchDirector = std::make_unique<alicia::RanchDirector>(
+    *g_dataDirector,
+    *g_ioContextPool,
+    *g_timingWheel,
+    settings._ranchSettings);
+
+  // Messenger.
+  alicia::CommandServer messengerServer("Messenger", *g_ioContextPool);
+  // TODO: Messenger
+  messengerServer.Host(boost::asio::ip::address_v4::any(), 10032);
+
+  // Report the log messages dropped because of the full log queue.
+  boost::asio::steady_timer logOverrunTimer(g_ioContextPool->GetContext());
+  ReportLogOverruns(logOverrunTimer, 0);
+
+  // Run the timing wheel, after the hosts added their listeners.
+  g_timingWheel->Start();
+
+  // Run the I/O threads.
+  g_ioContextPool->Run();
 
   return 0;
 }
@@ -11,91 +11,286 @@ namespace alicia
 
 RanchDirector::RanchDirector(
   DataDirector& dataDirector,
+  IoContextPool& ioContextPool,
+  TimingWheel& timingWheel,
   Settings::RanchSettings settings)
   : _settings(std::move(settings))
   , _dataDirector(dataDirector)
-  , _server("Ranch")
+  , _server("Ranch", ioContextPool)
+  , _tickInterval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::seconds(1)) / std::max(_settings.tickRate, 1u))
+  , _tickTimer(ioContextPool.GetContext())
 {
-  _ranches[100] = RanchInstance {};
+  _ranches.try_emplace(100);
 
   // Handlers
 
   // EnterRanch handler
-  _server.RegisterCommandHandler<RanchCommandEnterRanch>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleEnterRanch>(
     CommandId::RanchEnterRanch,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleEnterRanch(clientId, message);
-    });
+    this);
 
   // Snapshot handler
-  _server.RegisterCommandHandler<RanchCommandRanchSnapshot>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleSnapshot>(
     CommandId::RanchSnapshot,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleSnapshot(clientId, message);
-    });
+    this);
 
   // RanchCmdAction handler
-  _server.RegisterCommandHandler<RanchCommandRanchCmdAction>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleCmdAction>(
     CommandId::RanchCmdAction,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleCmdAction(clientId, message);
-    });
+    this);
 
   // RanchStuff handler
-  _server.RegisterCommandHandler<RanchCommandRanchStuff>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleRanchStuff>(
     CommandId::RanchStuff,
-    [this](ClientId clientId, const auto& message)
-    {
-      HandleRanchStuff(clientId, message);
-    });
+    this);
 
-  _server.RegisterCommandHandler<RanchCommandUpdateBusyState>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleUpdateBusyState>(
     CommandId::RanchUpdateBusyState,
-    [this](ClientId clientId, auto& command)
-    {
-      HandleUpdateBusyState(clientId, command); 
-    });
-  
-  _server.RegisterCommandHandler<RanchCommandSearchStallion>(
+    this);
+
+  _server.RegisterCommandHandler<&RanchDirector::HandleSearchStallion>(
     CommandId::RanchSearchStallion,
-    [this](ClientId clientId, auto& command)
-    {
-      HandleSearchStallion(clientId, command); 
-    });
+    this);
 
-  _server.RegisterCommandHandler<RanchCommandEnterBreedingMarket>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleEnterBreedingMarket>(
     CommandId::RanchEnterBreedingMarket,
-    [this](ClientId clientId, auto& command)
-    {
-      HandleEnterBreedingMarket(clientId, command); 
-    });
+    this);
 
-  _server.RegisterCommandHandler<RanchCommandTryBreeding>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleTryBreeding>(
     CommandId::RanchTryBreeding,
-    [this](ClientId clientId, auto& command)
-    {
-      HandleTryBreeding(clientId, command); 
-    });
+    this);
 
-  _server.RegisterCommandHandler<RanchCommandBreedingWishlist>(
+  _server.RegisterCommandHandler<&RanchDirector::HandleBreedingWishlist>(
     CommandId::RanchBreedingWishlist,
-    [this](ClientId clientId, auto& command)
+    this);
+
+  _server.RegisterCommandHandler<&RanchDirector::HandleUpdateMountNickname>(
+    CommandId::RanchUpdateMountNickname,
+    this);
+
+  _server.RegisterCommandHandler<&RanchDirector::HandleHeartbeat>(
+    CommandId::RanchHeartbeat,
+    this);
+
+  _server.RegisterDisconnectHandler(
+    [this](ClientId clientId)
     {
-      HandleBreedingWishlist(clientId, command); 
+      HandleClientDisconnect(clientId);
     });
 
-  _server.RegisterCommandHandler<RanchCommandUpdateMountNickname>(
-    CommandId::RanchUpdateMountNickname,
-    [this](ClientId clientId, auto& command)
+  // Disconnect the clients which don't send the commands in time.
+  _server.EnableTimeouts(
+    timingWheel,
     {
-      HandleUpdateMountNickname(clientId, command); 
+      .handshake = std::chrono::seconds(_settings.handshakeTimeout),
+      .idle = std::chrono::seconds(_settings.idleTimeout),
+      .stall = std::chrono::seconds(_settings.writeStallTimeout)
     });
 
+  // Drop the stale snapshots of the clients which don't keep up with them.
+  _server.EnableWriteLimits({
+    .highWatermark = _settings.writeHighWatermark,
+    .lowWatermark = _settings.writeLowWatermark,
+    .maxQueuedSize = _settings.writeQueueLimit});
+
   // Host the server.
-  _server.Host(_settings.address, _settings.port);
+  _server.Host(_settings.address, _settings.port, _settings.reusePort);
+
+  // Run the ranch tick.
+  _tickTimer.expires_after(_tickInterval);
+  ScheduleTick();
+}
+
+void RanchDirector::ScheduleTick()
+{
+  _tickTimer.async_wait(
+    [this](const boost::system::error_code& error)
+    {
+      if (error)
+      {
+        return;
+      }
+
+      try
+      {
+        Tick();
+      }
+      catch (const std::exception& x)
+      {
+        spdlog::error("Error in the ranch tick: {}", x.what());
+      }
+
+      // Keep the fixed rate of the tick,
+      // unless the tick is running behind by more than one interval.
+      const auto now = std::chrono::steady_clock::now();
+      const auto nextTick = _tickTimer.expiry() + _tickInterval;
+      _tickTimer.expires_at(nextTick < now ? now + _tickInterval : nextTick);
+
+      ScheduleTick();
+    });
+}
+
+RanchDirector::RanchInstance* RanchDirector::GetClientRanch(ClientId clientId)
+{
+  std::scoped_lock lock(_clientsMutex);
+
+  const auto ranchItr = _clientRanches.find(clientId);
+  if (ranchItr == _clientRanches.cend())
+  {
+    return nullptr;
+  }
+
+  return &_ranches[ranchItr->second];
+}
+
+DatumUid RanchDirector::GetClientCharacter(ClientId clientId)
+{
+  std::scoped_lock lock(_clientsMutex);
+
+  const auto characterItr = _clientCharacters.find(clientId);
+  if (characterItr == _clientCharacters.cend())
+  {
+    return InvalidDatumUid;
+  }
+
+  return characterItr->second;
+}
+
+void RanchDirector::Tick()
+{
+  _tickRanches.clear();
+  {
+    std::scoped_lock lock(_clientsMutex);
+    for (auto& [ranchUid, ranchInstance] : _ranches)
+    {
+      _tickRanches.emplace_back(&ranchInstance);
+    }
+  }
+
+  // Recipients of a snapshot.
+  std::vector<ClientId> recipients;
+
+  // Each ranch is locked only while its snapshots are relayed,
+  // the handlers of the other ranches keep running meanwhile.
+  for (RanchInstance* ranchInstance : _tickRanches)
+  {
+    std::scoped_lock lock(ranchInstance->_mutex);
+    if (ranchInstance->_pendingSnapshots.empty())
+    {
+      continue;
+    }
+
+    // Relay each snapshot to the members of the ranch.
+    // The snapshots queued for a client during the tick are sent with a single write.
+    for (const auto& [entityId, pendingSnapshot] : ranchInstance->_pendingSnapshots)
+    {
+      recipients.clear();
+      for (const auto& member : ranchInstance->_members)
+      {
+        // Do not relay the snapshot to the client that sent it.
+        if (pendingSnapshot.clientId == member.clientId)
+        {
+          continue;
+        }
+
+        recipients.emplace_back(member.clientId);
+      }
+
+      _server.BroadcastCommand(
+        recipients,
+        CommandId::RanchSnapshotNotify,
+        [&](auto& sink)
+        {
+          RanchCommandRanchSnapshotNotify::Write(pendingSnapshot.notify, sink);
+        },
+        entityId);
+    }
+
+    ranchInstance->_pendingSnapshots.clear();
+  }
+}
+
+EntityId RanchDirector::RanchInstance::AddMember(ClientId clientId, DatumUid characterUid)
+{
+  const auto [indexItr, inserted] = _memberIndices.try_emplace(
+    clientId, _members.size());
+  if (!inserted)
+  {
+    // The client is already a member, update its character.
+    auto& member = _members[indexItr->second];
+    if (member.characterUid != characterUid)
+    {
+      _pendingSnapshots.erase(_worldTracker.RemoveCharacter(member.characterUid));
+      member.characterUid = characterUid;
+      member.entityId = _worldTracker.AddCharacter(characterUid);
+    }
+
+    return member.entityId;
+  }
+
+  EntityId entityId = InvalidEntityId;
+  try
+  {
+    entityId = _worldTracker.AddCharacter(characterUid);
+  }
+  catch (...)
+  {
+    _memberIndices.erase(indexItr);
+    throw;
+  }
+
+  _members.emplace_back(RanchMember{
+    .clientId = clientId,
+    .characterUid = characterUid,
+    .entityId = entityId});
+  return entityId;
+}
+
+EntityId RanchDirector::RanchInstance::RemoveMember(ClientId clientId)
+{
+  const auto indexItr = _memberIndices.find(clientId);
+  if (indexItr == _memberIndices.cend())
+  {
+    return InvalidEntityId;
+  }
+
+  const std::size_t index = indexItr->second;
+  const EntityId entityId = _members[index].entityId;
+  _worldTracker.RemoveCharacter(_members[index].characterUid);
+  _pendingSnapshots.erase(entityId);
+  _memberIndices.erase(indexItr);
+
+  // Move the last member in place of the removed one to keep the array dense.
+  if (index != _members.size() - 1)
+  {
+    _members[index] = _members.back();
+    _memberIndices[_members[index].clientId] = index;
+  }
+  _members.pop_back();
+
+  return entityId;
+}
+
+void RanchDirector::HandleClientDisconnect(ClientId clientId)
+{
+  RanchInstance* ranchInstance = nullptr;
+  {
+    std::scoped_lock lock(_clientsMutex);
+    _clientCharacters.erase(clientId);
+
+    const auto ranchItr = _clientRanches.find(clientId);
+    if (ranchItr == _clientRanches.cend())
+    {
+      return;
+    }
+
+    ranchInstance = &_ranches[ranchItr->second];
+    _clientRanches.erase(ranchItr);
+  }
+
+  std::scoped_lock lock(ranchInstance->_mutex);
+  ranchInstance->RemoveMember(clientId);
 }
 
 void RanchDirector::HandleEnterRanch(
@@ -110,34 +305,104 @@ void RanchDirector::HandleEnterRanch(
   // Ranch the character is entering.
   const auto ranchUid = enterRanch.ranchUid;
 
-  _clientCharacters[clientId] = characterUid;
+  // The data are accessed without the ranch locked,
+  // as the data missing in the cache are loaded from the storage.
+  const std::string ranchName = _dataDirector.GetRanch(ranchUid)->ranchName;
+
+  RanchInstance* previousRanchInstance = nullptr;
+  RanchInstance* ranchInstance = nullptr;
+  {
+    std::scoped_lock lock(_clientsMutex);
+    _clientCharacters[clientId] = characterUid;
+
+    const auto [previousRanchItr, firstRanch] = _clientRanches.try_emplace(clientId, ranchUid);
+    if (!firstRanch)
+    {
+      previousRanchInstance = &_ranches[previousRanchItr->second];
+      previousRanchItr->second = ranchUid;
+    }
+
+    ranchInstance = &_ranches[ranchUid];
+  }
+
+  // Leave the ranch the client was on before.
+  if (previousRanchInstance != nullptr)
+  {
+    std::scoped_lock lock(previousRanchInstance->_mutex);
+    previousRanchInstance->RemoveMember(clientId);
+  }
+
+  // Add character to the ranch, and take the entities and the other members of the ranch.
+  std::vector<WorldTracker::Entity> mountEntities;
+  std::vector<WorldTracker::Entity> characterEntities;
+  std::vector<ClientId> recipients;
+  {
+    std::scoped_lock lock(ranchInstance->_mutex);
+    ranchInstance->AddMember(clientId, characterUid);
 
-  auto ranch = _dataDirector.GetRanch(ranchUid);
-  auto& ranchInstance = _ranches[ranchUid];
+    const auto ranchMountEntities = ranchInstance->_worldTracker.GetMountEntities();
+    mountEntities.assign(ranchMountEntities.begin(), ranchMountEntities.end());
+    const auto ranchCharacterEntities = ranchInstance->_worldTracker.GetCharacterEntities();
+    characterEntities.assign(ranchCharacterEntities.begin(), ranchCharacterEntities.end());
 
-  // Add character to the ranch.
-  ranchInstance._worldTracker.AddCharacter(characterUid);
+    for (const auto& member : ranchInstance->_members)
+    {
+      // Do not broadcast to the client that is entering.
+      if (member.clientId == clientId)
+      {
+        continue;
+      }
+
+      recipients.emplace_back(member.clientId);
+    }
+  }
 
   RanchPlayer enteringRanchPlayer;
   RanchCommandEnterRanchOK response{
     .ranchId = enterRanch.ranchUid,
     .unk0 = "unk0",
-    .ranchName = ranch->ranchName,
+    .ranchName = ranchName,
+    .unk10 = {},
     .unk11 = {
       .unk0 = 1,
       .unk1 = 1}
   };
 
+  // Access the characters on the ranch in one batch.
+  std::vector<DatumUid> characterUids;
+  characterUids.reserve(characterEntities.size());
+  for (const auto& [characterUid, characterEntityId] : characterEntities)
+  {
+    characterUids.emplace_back(characterUid);
+  }
+
+  const auto ranchCharacters = _dataDirector.GetCharacters(characterUids);
+
+  // Access the ranch mounts followed by the mounts of the characters in one batch.
+  std::vector<DatumUid> mountUids;
+  mountUids.reserve(mountEntities.size() + characterUids.size());
+  for (const auto& [mountUid, mountEntityId] : mountEntities)
+  {
+    mountUids.emplace_back(mountUid);
+  }
+  for (std::size_t characterIndex = 0; characterIndex < ranchCharacters.GetSize(); ++characterIndex)
+  {
+    mountUids.emplace_back(ranchCharacters[characterIndex].mountUid);
+  }
+
+  const auto mounts = _dataDirector.GetMounts(mountUids);
+  std::size_t mountIndex = 0;
+
   // Add the ranch mounts.
-  for (auto [mountUid, mountEntityId] : ranchInstance._worldTracker.GetMountEntities())
+  for (auto [mountUid, mountEntityId] : mountEntities)
   {
-    const auto& mount = _dataDirector.GetMount(mountUid);
+    const auto& mount = mounts[mountIndex++];
     response.horses.push_back({
       .ranchIndex = mountEntityId,
       .horse = {
         .uid = mountUid,
-        .tid = mount->tid,
-        .name = mount->name,
+        .tid = mount.tid,
+        .name = mount.name,
         .parts = {.skinId = 0x2, .maneId = 0x3, .tailId = 0x3, .faceId = 0x3},
         .appearance = {
           .scale = 0x4,
@@ -199,21 +464,22 @@ void RanchDirector::HandleEnterRanch(
   }
 
   // Add the ranch players.
-  for (auto [characterUid, characterEntityId] : ranchInstance._worldTracker.GetCharacterEntities())
+  std::size_t characterIndex = 0;
+  for (auto [characterUid, characterEntityId] : characterEntities)
   {
-    auto ranchCharacter = _dataDirector.GetCharacter(characterUid);
-    auto ranchCharacterMount = _dataDirector.GetMount(ranchCharacter->mountUid);
+    const auto& ranchCharacter = ranchCharacters[characterIndex++];
+    const auto& ranchCharacterMount = mounts[mountIndex++];
 
     const RanchPlayer ranchPlayer{
       .userUid = characterUid,
-      .name = ranchCharacter->nickName,
-      .gender = ranchCharacter->gender,
+      .name = ranchCharacter.nickName,
+      .gender = ranchCharacter.gender,
       .unk0 = 1,
       .unk1 = 1,
-      .description = ranchCharacter->status,
+      .description = ranchCharacter.status,
       .character = {
         .parts = {
-          .charId = static_cast<uint8_t>(ranchCharacter->gender == Gender::Boy ? 10 : 20),
+          .charId = static_cast<uint8_t>(ranchCharacter.gender == Gender::Boy ? 10 : 20),
           .mouthSerialId = 0x01,
           .faceSerialId = 0x2,
           .val0 = 0x01},
@@ -225,9 +491,9 @@ void RanchDirector::HandleEnterRanch(
           .legVolume = 0x01,
           .val1 = 0xFF}},
       .horse = {
-        .uid = ranchCharacter->mountUid,
-        .tid = ranchCharacterMount->tid,
-        .name = ranchCharacterMount->name,
+        .uid = ranchCharacter.mountUid,
+        .tid = ranchCharacterMount.tid,
+        .name = ranchCharacterMount.name,
         .parts = {.skinId = 0x2, .maneId = 0x3, .tailId = 0x3, .faceId = 0x3},
         .appearance =
           {.scale = 0x4,
@@ -295,12 +561,12 @@ void RanchDirector::HandleEnterRanch(
         .val16 = 0xb8a167e4,
         .val17 = 0
       },
-      .characterEquipment = ranchCharacter->characterEquipment,
+      .characterEquipment = ranchCharacter.characterEquipment,
       .playerRelatedThing = {
         .val1 = 1
       },
       .ranchIndex = characterEntityId,
-      .anotherPlayerRelatedThing = {.mountUid = ranchCharacter->mountUid, .val1 = 0x12}
+      .anotherPlayerRelatedThing = {.mountUid = ranchCharacter.mountUid, .val1 = 0x12}
     };
 
     if (enterRanch.characterUid == characterUid)
@@ -327,74 +593,43 @@ void RanchDirector::HandleEnterRanch(
     .player = enteringRanchPlayer
   };
 
-  // Iterate over all the clients and broadcast join notification.
-  for (auto [clientId, clientCharacterUid] : _clientCharacters)
-  {
-    // Todo: Too many uncecessary lookups
-    // Do not broadcast to the client that sent the snapshot.
-    if (clientCharacterUid == characterUid)
-    {
-      continue;
-    }
-
-    // Do not broadcast to clients that are not on the ranch.
-    const EntityId characterEntityId = ranchInstance._worldTracker.GetCharacterEntityId(
-      clientCharacterUid);
-    if (characterEntityId == InvalidEntityId)
-    {
-      continue;
-    }
-
-    _server.QueueCommand(
-      clientId,
-      CommandId::RanchEnterRanchNotify,
-      [&](auto& sink){
-        RanchCommandEnterRanchNotify::Write(notification, sink);
-      });
-  }
+  // Broadcast join notification to the members of the ranch.
+  _server.BroadcastCommand(
+    recipients,
+    CommandId::RanchEnterRanchNotify,
+    [&](auto& sink){
+      RanchCommandEnterRanchNotify::Write(notification, sink);
+    });
 }
 
 void RanchDirector::HandleSnapshot(
   ClientId clientId,
   const RanchCommandRanchSnapshot& snapshot)
 {
-  const DatumUid characterUid = _clientCharacters[clientId];
-
-  auto character = _dataDirector.GetCharacter(characterUid);
-  auto& ranchInstance = _ranches[character->ranchUid];
-
-  const RanchCommandRanchSnapshotNotify response {
-    .ranchIndex = ranchInstance._worldTracker.GetCharacterEntityId(characterUid),
-    .unk0 = snapshot.unk0,
-    .snapshot = snapshot.snapshot
-  };
+  // Ignore the snapshots of clients that are not on a ranch.
+  RanchInstance* ranchInstance = GetClientRanch(clientId);
+  if (ranchInstance == nullptr)
+  {
+    return;
+  }
 
-  // Iterate over all the clients and broadcast the snapshot.
-  for (auto [clientId, clientCharacterUid] : _clientCharacters)
+  std::scoped_lock lock(ranchInstance->_mutex);
+  const auto memberItr = ranchInstance->_memberIndices.find(clientId);
+  if (memberItr == ranchInstance->_memberIndices.cend())
   {
-    // Todo: Too many uncecessary lookups
-    // Do not broadcast to the client that sent the snapshot.
-    if (clientCharacterUid == characterUid)
-    {
-      continue;
-    }
+    return;
+  }
 
-    // Do not broadcast to clients that are not on the ranch.
-    const EntityId characterEntityId = ranchInstance._worldTracker.GetCharacterEntityId(
-      clientCharacterUid);
-    if (characterEntityId == InvalidEntityId)
-    {
-      continue;
-    }
+  const EntityId characterEntityId = ranchInstance->_members[memberItr->second].entityId;
 
-    _server.QueueCommand(
-      clientId,
-      CommandId::RanchSnapshotNotify,
-      [&](auto& sink)
-      {
-        RanchCommandRanchSnapshotNotify::Write(response, sink);
-      });
-  }
+  // Keep only the latest snapshot of the entity,
+  // it is relayed to the other clients on the next tick.
+  ranchInstance->_pendingSnapshots[characterEntityId] = {
+    .clientId = clientId,
+    .notify = {
+      .ranchIndex = characterEntityId,
+      .unk0 = snapshot.unk0,
+      .snapshot = snapshot.snapshot}};
 }
 
 void RanchDirector::HandleCmdAction(ClientId clientId, const RanchCommandRanchCmdAction& action)
@@ -416,8 +651,13 @@ void RanchDirector::HandleCmdAction(ClientId clientId, const RanchCommandRanchCm
 
 void RanchDirector::HandleRanchStuff(ClientId clientId, const RanchCommandRanchStuff& command)
 {
-  const DatumUid characterUid = _clientCharacters[clientId];
-  auto character = _dataDirector.GetCharacter(characterUid);
+  const DatumUid characterUid = GetClientCharacter(clientId);
+  if (characterUid == InvalidDatumUid)
+  {
+    return;
+  }
+
+  auto character = _dataDirector.GetCharacterMutable(characterUid);
 
   // todo: needs validation
   character->carrots += command.value;
@@ -439,26 +679,31 @@ void RanchDirector::HandleRanchStuff(ClientId clientId, const RanchCommandRanchS
 
 void RanchDirector::HandleUpdateBusyState(ClientId clientId, const RanchCommandUpdateBusyState& command)
 {
-  const DatumUid characterUid = _clientCharacters[clientId];
-  auto character = _dataDirector.GetCharacter(characterUid);
-  auto& ranchInstance = _ranches[character->ranchUid];
+  const DatumUid characterUid = GetClientCharacter(clientId);
+  RanchInstance* ranchInstance = GetClientRanch(clientId);
+  if (ranchInstance == nullptr)
+  {
+    return;
+  }
 
   // TODO: Store the busy state in the character instance
 
   RanchCommandUpdateBusyStateNotify response {.characterId = characterUid, .busyState = command.busyState};
 
-  for (auto [clientId, clientCharacterUid] : _clientCharacters)
+  std::vector<ClientId> recipients;
   {
-    if (ranchInstance._worldTracker.GetCharacterEntityId(clientCharacterUid) == InvalidEntityId)
+    std::scoped_lock lock(ranchInstance->_mutex);
+    for (const auto& member : ranchInstance->_members)
     {
-      continue;
+      recipients.emplace_back(member.clientId);
     }
-    
-    _server.QueueCommand(
-      clientId,
-      CommandId::RanchSnapshotNotify,
-      [&](auto& sink) { RanchCommandUpdateBusyStateNotify::Write(response, sink); });
   }
+
+  _server.BroadcastCommand(
+    recipients,
+    CommandId::RanchUpdateBusyStateNotify,
+    [&](auto& sink) { RanchCommandUpdateBusyStateNotify::Write(response, sink); },
+    characterUid);
 }
 
 void RanchDirector::HandleSearchStallion(ClientId clientId, const RanchCommandSearchStallion& command)
@@ -516,7 +761,12 @@ void RanchDirector::HandleSearchStallion(ClientId clientId, const RanchCommandSe
 
 void RanchDirector::HandleEnterBreedingMarket(ClientId clientId, const RanchCommandEnterBreedingMarket& command)
 {
-  const DatumUid characterUid = _clientCharacters[clientId];
+  const DatumUid characterUid = GetClientCharacter(clientId);
+  if (characterUid == InvalidDatumUid)
+  {
+    return;
+  }
+
   auto character = _dataDirector.GetCharacter(characterUid);
   _server.QueueCommand(
     clientId,
@@ -624,4 +874,11 @@ void RanchDirector::HandleUpdateMountNickname(ClientId clientId, const RanchComm
     });
 }
 
+void RanchDirector::HandleHeartbeat(
+  ClientId clientId,
+  const RanchCommandHeartbeat& heartbeat)
+{
+  // The heartbeat, as any other command, extends the idle timeout of the client.
+}
+
 } // namespace alicia
@@ -0,0 +1,131 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+
+#include "server/storage/DataFile.hpp"
+
+#include <format>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+//! Syncs the file descriptor to the disk.
+//! @returns `true` if the file was synced, `false` otherwise.
+bool SyncDescriptor(int descriptor)
+{
+#ifdef _WIN32
+  return _commit(descriptor) == 0;
+#else
+  return fsync(descriptor) == 0;
+#endif
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+void SyncDataFile(std::FILE* file)
+{
+  if (std::fflush(file) != 0)
+  {
+    throw std::runtime_error("Couldn't flush the file");
+  }
+
+#ifdef _WIN32
+  const bool isSynced = SyncDescriptor(_fileno(file));
+#else
+  const bool isSynced = SyncDescriptor(fileno(file));
+#endif
+
+  if (!isSynced)
+  {
+    throw std::runtime_error("Couldn't sync the file");
+  }
+}
+
+void SyncDataFile(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+  const int descriptor = _wopen(path.c_str(), _O_WRONLY | _O_BINARY);
+#else
+  const int descriptor = open(path.c_str(), O_RDONLY);
+#endif
+
+  if (descriptor < 0)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't open the file '{}' to sync it",
+      path.string()));
+  }
+
+  const bool isSynced = SyncDescriptor(descriptor);
+
+#ifdef _WIN32
+  _close(descriptor);
+#else
+  close(descriptor);
+#endif
+
+  if (!isSynced)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't sync the file '{}'",
+      path.string()));
+  }
+}
+
+void SyncDataDirectory(const std::filesystem::path& path)
+{
+#ifndef _WIN32
+  // The directory entries are synced through the directory itself.
+  const std::filesystem::path directory = path.has_parent_path()
+    ? path.parent_path()
+    : std::filesystem::path(".");
+
+  const int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (descriptor < 0)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't open the directory '{}' to sync it",
+      directory.string()));
+  }
+
+  const bool isSynced = SyncDescriptor(descriptor);
+  close(descriptor);
+
+  if (!isSynced)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't sync the directory '{}'",
+      directory.string()));
+  }
+#endif
+}
+
+} // namespace alicia
@@ -0,0 +1,358 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "server/storage/DataJournal.hpp"
+#include "server/storage/DataFile.hpp"
+
+#include <libserver/Util.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace
+{
+
+//! Size of the journal header, the magic and the version.
+constexpr std::size_t HeaderSize = sizeof(uint32_t) * 2;
+
+//! Latest values of the replayed data.
+struct ReplayedData
+{
+  std::unordered_map<std::string, alicia::User> users;
+  std::unordered_map<alicia::DatumUid, alicia::User::Character> characters;
+  std::unordered_map<alicia::DatumUid, alicia::User::Mount> mounts;
+  std::unordered_map<alicia::DatumUid, alicia::User::Ranch> ranches;
+};
+
+//! Replays the journal file into the data.
+//! A journal torn by a crash is replayed up to the last whole record.
+void ReplayFile(const std::filesystem::path& path, ReplayedData& data)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    return;
+  }
+
+  const std::vector<char> content(
+    (std::istreambuf_iterator<char>(file)),
+    std::istreambuf_iterator<char>());
+  const auto journal = std::as_bytes(std::span(content));
+
+  if (journal.size() < HeaderSize)
+  {
+    spdlog::warn("Journal '{}' has no header, ignoring it", path.string());
+    return;
+  }
+
+  uint32_t magic{};
+  uint32_t version{};
+  alicia::SourceStream(journal)
+    .Read(magic)
+    .Read(version);
+  if (magic != alicia::DataJournalMagic || version != alicia::DataJournalVersion)
+  {
+    spdlog::warn("Journal '{}' is not a journal of version {}, ignoring it",
+      path.string(),
+      alicia::DataJournalVersion);
+    return;
+  }
+
+  std::size_t recordCount = 0;
+  const auto records = journal.subspan(HeaderSize);
+  std::size_t readSize = 0;
+  try
+  {
+    readSize = alicia::ReadDataRecords(
+      records,
+      [&data, &recordCount](const alicia::DataRecord& record)
+      {
+        switch (record.kind)
+        {
+          case alicia::DataRecordKind::User:
+            data.users[std::string(alicia::ReadUserRecordKey(record.payload))] =
+              alicia::ReadUserRecord(record.payload);
+            break;
+          case alicia::DataRecordKind::Character:
+            data.characters[alicia::ReadDatumRecordKey(record.payload)] =
+              alicia::ReadCharacterRecord(record.payload);
+            break;
+          case alicia::DataRecordKind::Mount:
+            data.mounts[alicia::ReadDatumRecordKey(record.payload)] =
+              alicia::ReadMountRecord(record.payload);
+            break;
+          case alicia::DataRecordKind::Ranch:
+            data.ranches[alicia::ReadDatumRecordKey(record.payload)] =
+              alicia::ReadRanchRecord(record.payload);
+            break;
+          default:
+            throw std::runtime_error("Unknown record kind");
+        }
+
+        ++recordCount;
+      });
+  }
+  catch (const std::exception& x)
+  {
+    spdlog::warn(
+      "Journal '{}' has a corrupted record after {} records, ignoring the rest: {}",
+      path.string(),
+      recordCount,
+      x.what());
+  }
+
+  if (readSize != records.size())
+  {
+    spdlog::warn("Journal '{}' is torn, replaying {} whole records", path.string(), recordCount);
+  }
+
+  spdlog::info("Replayed {} records from the journal '{}'", recordCount, path.string());
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+DataJournal::DataJournal(std::filesystem::path path)
+  : _path(std::move(path))
+  , _rotatedPath(_path.string() + ".rotated")
+{
+}
+
+DataJournal::~DataJournal()
+{
+  Close();
+}
+
+DataBatch DataJournal::Replay()
+{
+  // The rotated journal is left by a crash during the compaction,
+  // its records precede the records of the current journal.
+  ReplayedData data;
+  ReplayFile(_rotatedPath, data);
+  ReplayFile(_path, data);
+
+  DataBatch batch;
+  batch.users.assign(data.users.begin(), data.users.end());
+  batch.characters.assign(data.characters.begin(), data.characters.end());
+  batch.mounts.assign(data.mounts.begin(), data.mounts.end());
+  batch.ranches.assign(data.ranches.begin(), data.ranches.end());
+
+  // Compact the replayed journals to a single journal.
+  const std::filesystem::path compactedPath = _path.string() + ".tmp";
+  Open(compactedPath, true);
+  Write(batch);
+  Sync();
+  Close();
+
+  // The compacted journal replaces the journals only once the rename is durable.
+  std::filesystem::rename(compactedPath, _path);
+  SyncDataDirectory(_path);
+  std::filesystem::remove(_rotatedPath);
+  SyncDataDirectory(_rotatedPath);
+
+  Open(_path, false);
+  return batch;
+}
+
+void DataJournal::Append(const DataBatch& batch)
+{
+  // The replay stops at the partial batch of a failed append,
+  // which is discarded before any other batch is appended.
+  if (_isTorn)
+  {
+    Truncate();
+  }
+  else if (_file == nullptr)
+  {
+    Reopen();
+  }
+
+  try
+  {
+    const std::size_t size = Write(batch);
+    Sync();
+    _syncedSize += size;
+  }
+  catch (const std::exception&)
+  {
+    _isTorn = true;
+    try
+    {
+      Truncate();
+    }
+    catch (const std::exception& x)
+    {
+      spdlog::error("Couldn't truncate the journal '{}': {}", _path.string(), x.what());
+    }
+
+    throw;
+  }
+}
+
+void DataJournal::Rotate()
+{
+  // The journal rotated by a failed compaction is kept,
+  // the current journal continues after it.
+  if (std::filesystem::exists(_rotatedPath))
+  {
+    return;
+  }
+
+  // The rotated journal must not end with a partial batch either.
+  if (_isTorn)
+  {
+    Truncate();
+  }
+  else if (_file == nullptr)
+  {
+    Reopen();
+  }
+
+  Close();
+  std::filesystem::rename(_path, _rotatedPath);
+  Open(_path, true);
+
+  // The records appended to the new journal are lost, unless its creation is durable.
+  SyncDataDirectory(_path);
+}
+
+void DataJournal::DiscardRotated()
+{
+  std::filesystem::remove(_rotatedPath);
+  SyncDataDirectory(_rotatedPath);
+}
+
+void DataJournal::Open(const std::filesystem::path& path, bool isNew)
+{
+  if (path.has_parent_path())
+  {
+    std::filesystem::create_directories(path.parent_path());
+  }
+
+  _file = std::fopen(path.string().c_str(), isNew ? "wb" : "ab");
+  if (_file == nullptr)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't open the journal '{}'",
+      path.string()));
+  }
+
+  // The journal is either open and whole, or closed.
+  try
+  {
+    if (isNew)
+    {
+      std::array<std::byte, HeaderSize> header{};
+      SinkStream(header)
+        .Write(DataJournalMagic)
+        .Write(DataJournalVersion);
+      if (std::fwrite(header.data(), 1, header.size(), _file) != header.size())
+      {
+        throw std::runtime_error(std::format(
+          "Couldn't write the header of the journal '{}'",
+          path.string()));
+      }
+
+      Sync();
+      _syncedSize = HeaderSize;
+    }
+    else
+    {
+      _syncedSize = std::filesystem::file_size(path);
+    }
+  }
+  catch (const std::exception&)
+  {
+    Close();
+    throw;
+  }
+}
+
+std::size_t DataJournal::Write(const DataBatch& batch)
+{
+  std::size_t size = 0;
+  const auto writeRecord = [this, &size](std::span<const std::byte> record)
+  {
+    if (std::fwrite(record.data(), 1, record.size(), _file) != record.size())
+    {
+      throw std::runtime_error("Couldn't write to the journal");
+    }
+
+    size += record.size();
+  };
+
+  for (const auto& [name, user] : batch.users)
+  {
+    writeRecord(_recordWriter.Write(name, user));
+  }
+  for (const auto& [characterUid, character] : batch.characters)
+  {
+    writeRecord(_recordWriter.Write(characterUid, character));
+  }
+  for (const auto& [mountUid, mount] : batch.mounts)
+  {
+    writeRecord(_recordWriter.Write(mountUid, mount));
+  }
+  for (const auto& [ranchUid, ranch] : batch.ranches)
+  {
+    writeRecord(_recordWriter.Write(ranchUid, ranch));
+  }
+
+  return size;
+}
+
+void DataJournal::Reopen()
+{
+  // The journal without a whole header, or removed by the rotation, is created anew.
+  const bool isNew = !std::filesystem::exists(_path)
+    || std::filesystem::file_size(_path) < HeaderSize;
+  Open(_path, isNew);
+}
+
+void DataJournal::Sync()
+{
+  SyncDataFile(_file);
+}
+
+void DataJournal::Truncate()
+{
+  // Closing the file writes out its buffer, which is truncated right after.
+  Close();
+  std::filesystem::resize_file(_path, _syncedSize);
+  SyncDataFile(_path);
+  Open(_path, false);
+
+  _isTorn = false;
+}
+
+void DataJournal::Close()
+{
+  if (_file != nullptr)
+  {
+    std::fclose(_file);
+    _file = nullptr;
+  }
+}
+
+} // namespace alicia
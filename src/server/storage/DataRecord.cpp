@@ -0,0 +1,277 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "server/storage/DataRecord.hpp"
+
+#include <libserver/Util.hpp>
+
+namespace
+{
+
+//! Initial size of the record buffer.
+constexpr std::size_t InitialRecordBufferSize = 4096;
+
+void WriteItems(alicia::SinkStream& sink, const std::vector<alicia::Item>& items)
+{
+  sink.Write(static_cast<uint32_t>(items.size()));
+  for (const auto& item : items)
+  {
+    sink.Write(item.uid)
+      .Write(item.tid)
+      .Write(item.val)
+      .Write(item.count);
+  }
+}
+
+//! Reads the count of the elements, which must fit in the remaining data.
+uint32_t ReadCount(alicia::SourceStream& source, std::size_t elementSize)
+{
+  uint32_t count{};
+  source.Read(count);
+
+  if (count > source.GetRemaining().size() / elementSize)
+  {
+    throw std::overflow_error("Record element count exceeds the record");
+  }
+
+  return count;
+}
+
+void ReadItems(alicia::SourceStream& source, std::vector<alicia::Item>& items)
+{
+  items.resize(ReadCount(source, sizeof(uint32_t) * 4));
+  for (auto& item : items)
+  {
+    source.Read(item.uid)
+      .Read(item.tid)
+      .Read(item.val)
+      .Read(item.count);
+  }
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+DataRecordWriter::DataRecordWriter()
+  : _buffer(InitialRecordBufferSize)
+{
+}
+
+std::span<const std::byte> DataRecordWriter::Write(const std::string& name, const User& user)
+{
+  return WriteRecord(
+    DataRecordKind::User,
+    [&](SinkStream& sink)
+    {
+      sink.Write(name)
+        .Write(user._token)
+        .Write(user.characterUid);
+    });
+}
+
+std::span<const std::byte> DataRecordWriter::Write(
+  DatumUid characterUid,
+  const User::Character& character)
+{
+  return WriteRecord(
+    DataRecordKind::Character,
+    [&](SinkStream& sink)
+    {
+      sink.Write(characterUid)
+        .Write(character.nickName)
+        .Write(character.gender)
+        .Write(character.level)
+        .Write(character.carrots)
+        .Write(character.ageGroup)
+        .Write(character.status)
+        .Write(character.mountUid)
+        .Write(character.ranchUid);
+
+      WriteItems(sink, character.characterEquipment);
+      WriteItems(sink, character.horseEquipment);
+
+      sink.Write(static_cast<uint32_t>(character.horses.size()));
+      for (const auto horse : character.horses)
+      {
+        sink.Write(horse);
+      }
+    });
+}
+
+std::span<const std::byte> DataRecordWriter::Write(DatumUid mountUid, const User::Mount& mount)
+{
+  return WriteRecord(
+    DataRecordKind::Mount,
+    [&](SinkStream& sink)
+    {
+      sink.Write(mountUid)
+        .Write(mount.tid)
+        .Write(mount.name);
+    });
+}
+
+std::span<const std::byte> DataRecordWriter::Write(DatumUid ranchUid, const User::Ranch& ranch)
+{
+  return WriteRecord(
+    DataRecordKind::Ranch,
+    [&](SinkStream& sink)
+    {
+      sink.Write(ranchUid)
+        .Write(ranch.ranchName);
+    });
+}
+
+template<typename Writer>
+std::span<const std::byte> DataRecordWriter::WriteRecord(
+  DataRecordKind kind,
+  const Writer& writer)
+{
+  std::size_t payloadSize = 0;
+  while (true)
+  {
+    const std::span payload = std::span(_buffer).subspan(DataRecordHeaderSize);
+    SinkStream sink(payload);
+    try
+    {
+      writer(sink);
+      payloadSize = sink.GetCursor();
+      break;
+    }
+    catch (const std::overflow_error&)
+    {
+      _buffer.resize(_buffer.size() * 2);
+    }
+  }
+
+  const std::span header = std::span(_buffer).first(DataRecordHeaderSize);
+  SinkStream(header)
+    .Write(kind)
+    .Write(static_cast<uint32_t>(payloadSize));
+
+  return std::span(_buffer).first(DataRecordHeaderSize + payloadSize);
+}
+
+std::size_t ReadDataRecords(
+  std::span<const std::byte> data,
+  const std::function<void(const DataRecord& record)>& consumer)
+{
+  SourceStream source(data);
+
+  while (source.GetRemaining().size() >= DataRecordHeaderSize)
+  {
+    DataRecordKind kind{};
+    uint32_t payloadSize{};
+    source.Read(kind)
+      .Read(payloadSize);
+
+    const auto remaining = source.GetRemaining();
+    if (payloadSize > remaining.size())
+    {
+      return source.GetCursor() - DataRecordHeaderSize;
+    }
+
+    consumer({
+      .kind = kind,
+      .payload = remaining.first(payloadSize)});
+    source.Seek(source.GetCursor() + payloadSize);
+  }
+
+  return source.GetCursor();
+}
+
+std::string_view ReadUserRecordKey(std::span<const std::byte> payload)
+{
+  std::string_view name;
+  SourceStream(payload).Read(name);
+  return name;
+}
+
+DatumUid ReadDatumRecordKey(std::span<const std::byte> payload)
+{
+  DatumUid uid{};
+  SourceStream(payload).Read(uid);
+  return uid;
+}
+
+User ReadUserRecord(std::span<const std::byte> payload)
+{
+  SourceStream source(payload);
+
+  std::string_view name;
+  User user;
+  source.Read(name)
+    .Read(user._token)
+    .Read(user.characterUid);
+  return user;
+}
+
+User::Character ReadCharacterRecord(std::span<const std::byte> payload)
+{
+  SourceStream source(payload);
+
+  DatumUid characterUid{};
+  User::Character character;
+  source.Read(characterUid)
+    .Read(character.nickName)
+    .Read(character.gender)
+    .Read(character.level)
+    .Read(character.carrots)
+    .Read(character.ageGroup)
+    .Read(character.status)
+    .Read(character.mountUid)
+    .Read(character.ranchUid);
+
+  ReadItems(source, character.characterEquipment);
+  ReadItems(source, character.horseEquipment);
+
+  character.horses.resize(ReadCount(source, sizeof(DatumUid)));
+  for (auto& horse : character.horses)
+  {
+    source.Read(horse);
+  }
+
+  return character;
+}
+
+User::Mount ReadMountRecord(std::span<const std::byte> payload)
+{
+  SourceStream source(payload);
+
+  DatumUid mountUid{};
+  User::Mount mount;
+  source.Read(mountUid)
+    .Read(mount.tid)
+    .Read(mount.name);
+  return mount;
+}
+
+User::Ranch ReadRanchRecord(std::span<const std::byte> payload)
+{
+  SourceStream source(payload);
+
+  DatumUid ranchUid{};
+  User::Ranch ranch;
+  source.Read(ranchUid)
+    .Read(ranch.ranchName);
+  return ranch;
+}
+
+} // namespace alicia
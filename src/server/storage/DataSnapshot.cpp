@@ -0,0 +1,429 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "server/storage/DataSnapshot.hpp"
+#include "server/storage/DataFile.hpp"
+
+#include <libserver/Util.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace
+{
+
+//! Size of the snapshot header, the magic, the version and the flush sequence.
+constexpr std::size_t HeaderSize = sizeof(uint32_t) * 2 + sizeof(uint64_t);
+//! Number of the records stored to the authoritative storage in a single batch.
+constexpr std::size_t CatchUpBatchSize = 256;
+//! Delay before retrying a failed catch-up store.
+constexpr auto CatchUpRetryDelay = std::chrono::seconds(5);
+
+//! Finds the record and decodes it.
+//! @returns Decoded record, or an empty optional if the record is not in the index.
+template<typename Index, typename Key, typename Reader>
+auto FindRecord(const Index& index, const Key& key, const Reader& reader)
+  -> std::optional<decltype(reader(std::span<const std::byte>{}))>
+{
+  const auto recordIter = index.find(key);
+  if (recordIter == index.cend())
+  {
+    return std::nullopt;
+  }
+
+  return reader(recordIter->second);
+}
+
+//! Decodes the records of the index to the values, up to the remaining count.
+template<typename Index, typename Reader, typename Values>
+void DecodeRecords(
+  const Index& index,
+  const Reader& reader,
+  Values& values,
+  std::size_t& remaining)
+{
+  for (const auto& [key, record] : index)
+  {
+    if (remaining == 0)
+    {
+      return;
+    }
+
+    values.emplace_back(key, reader(record));
+    --remaining;
+  }
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+DataSnapshotWriter::DataSnapshotWriter(std::filesystem::path path, uint64_t sequence)
+  : _path(std::move(path))
+  , _temporaryPath(_path.string() + ".tmp")
+{
+  if (_path.has_parent_path())
+  {
+    std::filesystem::create_directories(_path.parent_path());
+  }
+
+  _file.open(_temporaryPath, std::ios::binary | std::ios::trunc);
+  if (!_file)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't create the snapshot file '{}'",
+      _temporaryPath.string()));
+  }
+
+  std::array<std::byte, HeaderSize> header{};
+  SinkStream(header)
+    .Write(DataSnapshotMagic)
+    .Write(DataSnapshotVersion)
+    .Write(sequence);
+  _file.write(reinterpret_cast<const char*>(header.data()), header.size());
+}
+
+void DataSnapshotWriter::Write(const std::string& name, const User& user)
+{
+  WriteRecord(_recordWriter.Write(name, user));
+}
+
+void DataSnapshotWriter::Write(DatumUid characterUid, const User::Character& character)
+{
+  WriteRecord(_recordWriter.Write(characterUid, character));
+}
+
+void DataSnapshotWriter::Write(DatumUid mountUid, const User::Mount& mount)
+{
+  WriteRecord(_recordWriter.Write(mountUid, mount));
+}
+
+void DataSnapshotWriter::Write(DatumUid ranchUid, const User::Ranch& ranch)
+{
+  WriteRecord(_recordWriter.Write(ranchUid, ranch));
+}
+
+void DataSnapshotWriter::Commit()
+{
+  _file.close();
+  if (!_file)
+  {
+    throw std::runtime_error(std::format(
+      "Couldn't write the snapshot file '{}'",
+      _temporaryPath.string()));
+  }
+
+  // The snapshot must be durable before the data it holds are discarded elsewhere,
+  // its data are synced before the rename and the rename after it.
+  SyncDataFile(_temporaryPath);
+  std::filesystem::rename(_temporaryPath, _path);
+  SyncDataDirectory(_path);
+}
+
+void DataSnapshotWriter::WriteRecord(std::span<const std::byte> record)
+{
+  _file.write(
+    reinterpret_cast<const char*>(record.data()),
+    static_cast<std::streamsize>(record.size()));
+}
+
+SnapshotDataStorage::SnapshotDataStorage(
+  const std::filesystem::path& path,
+  DataStorage& storage)
+  : _storage(storage)
+  , _mapping(path.string().c_str(), boost::interprocess::read_only)
+  , _region(_mapping, boost::interprocess::read_only)
+{
+  const std::span snapshot(
+    static_cast<const std::byte*>(_region.get_address()),
+    _region.get_size());
+
+  SourceStream source(snapshot);
+
+  uint32_t magic{};
+  uint32_t version{};
+  source.Read(magic)
+    .Read(version);
+  if (magic != DataSnapshotMagic || version != DataSnapshotVersion)
+  {
+    throw std::runtime_error(std::format(
+      "Snapshot '{}' is not a snapshot of version {}",
+      path.string(),
+      DataSnapshotVersion));
+  }
+
+  source.Read(_sequence);
+
+  // Index the records by their keys, the records are decoded when loaded.
+  const auto records = snapshot.subspan(HeaderSize);
+  const std::size_t readSize = ReadDataRecords(
+    records,
+    [this, &path](const DataRecord& record)
+    {
+      switch (record.kind)
+      {
+        case DataRecordKind::User:
+          _users[std::string(ReadUserRecordKey(record.payload))] = record.payload;
+          break;
+        case DataRecordKind::Character:
+          _characters[ReadDatumRecordKey(record.payload)] = record.payload;
+          break;
+        case DataRecordKind::Mount:
+          _mounts[ReadDatumRecordKey(record.payload)] = record.payload;
+          break;
+        case DataRecordKind::Ranch:
+          _ranches[ReadDatumRecordKey(record.payload)] = record.payload;
+          break;
+        default:
+          spdlog::warn(
+            "Unknown record kind {} in the snapshot '{}'",
+            static_cast<uint8_t>(record.kind),
+            path.string());
+          break;
+      }
+    });
+
+  if (readSize != records.size())
+  {
+    throw std::runtime_error(std::format(
+      "Snapshot '{}' is truncated",
+      path.string()));
+  }
+
+  // The records flushed to the storage after the snapshot are newer in the storage.
+  const DataKeys supersededKeys = _storage.LoadKeysStoredAfter(_sequence);
+  Forget(supersededKeys);
+
+  spdlog::info(
+    "Mapped the snapshot '{}' with {} users, {} characters, {} mounts and {} ranches",
+    path.string(),
+    _users.size(),
+    _characters.size(),
+    _mounts.size(),
+    _ranches.size());
+
+  _catchUpThread = std::jthread(
+    [this](const std::stop_token& stopToken)
+    {
+      RunCatchUp(stopToken);
+    });
+}
+
+std::optional<User> SnapshotDataStorage::LoadUser(
+  const std::string& name)
+{
+  {
+    std::shared_lock lock(_indexMutex);
+    if (auto user = FindRecord(_users, name, ReadUserRecord))
+    {
+      return user;
+    }
+  }
+
+  return _storage.LoadUser(name);
+}
+
+std::optional<User::Character> SnapshotDataStorage::LoadCharacter(
+  DatumUid characterUid)
+{
+  {
+    std::shared_lock lock(_indexMutex);
+    if (auto character = FindRecord(_characters, characterUid, ReadCharacterRecord))
+    {
+      return character;
+    }
+  }
+
+  return _storage.LoadCharacter(characterUid);
+}
+
+std::optional<User::Mount> SnapshotDataStorage::LoadMount(
+  DatumUid mountUid)
+{
+  {
+    std::shared_lock lock(_indexMutex);
+    if (auto mount = FindRecord(_mounts, mountUid, ReadMountRecord))
+    {
+      return mount;
+    }
+  }
+
+  return _storage.LoadMount(mountUid);
+}
+
+std::optional<User::Ranch> SnapshotDataStorage::LoadRanch(
+  DatumUid ranchUid)
+{
+  {
+    std::shared_lock lock(_indexMutex);
+    if (auto ranch = FindRecord(_ranches, ranchUid, ReadRanchRecord))
+    {
+      return ranch;
+    }
+  }
+
+  return _storage.LoadRanch(ranchUid);
+}
+
+uint64_t SnapshotDataStorage::LoadSequence()
+{
+  // The data are flushed after the snapshot.
+  return std::max(_sequence, _storage.LoadSequence());
+}
+
+DataKeys SnapshotDataStorage::LoadKeysStoredAfter(uint64_t sequence)
+{
+  DataKeys keys = _storage.LoadKeysStoredAfter(sequence);
+  if (sequence >= _sequence)
+  {
+    return keys;
+  }
+
+  // The records of the snapshot are of its sequence.
+  std::shared_lock lock(_indexMutex);
+  for (const auto& [name, record] : _users)
+  {
+    keys.users.emplace_back(name);
+  }
+  for (const auto& [characterUid, record] : _characters)
+  {
+    keys.characters.emplace_back(characterUid);
+  }
+  for (const auto& [mountUid, record] : _mounts)
+  {
+    keys.mounts.emplace_back(mountUid);
+  }
+  for (const auto& [ranchUid, record] : _ranches)
+  {
+    keys.ranches.emplace_back(ranchUid);
+  }
+
+  return keys;
+}
+
+void SnapshotDataStorage::Store(const DataBatch& batch)
+{
+  std::scoped_lock storeLock(_storeMutex);
+  _storage.Store(batch);
+
+  // The stored data are newer than the snapshot.
+  std::unique_lock indexLock(_indexMutex);
+  Forget(batch);
+}
+
+void SnapshotDataStorage::RunCatchUp(const std::stop_token& stopToken)
+{
+  while (!stopToken.stop_requested())
+  {
+    std::unique_lock storeLock(_storeMutex);
+
+    // Decode the next batch of the records, the records are kept
+    // in the index until they are stored.
+    DataBatch batch;
+    batch.sequence = _sequence;
+    {
+      std::shared_lock indexLock(_indexMutex);
+
+      std::size_t remaining = CatchUpBatchSize;
+      DecodeRecords(_users, ReadUserRecord, batch.users, remaining);
+      DecodeRecords(_characters, ReadCharacterRecord, batch.characters, remaining);
+      DecodeRecords(_mounts, ReadMountRecord, batch.mounts, remaining);
+      DecodeRecords(_ranches, ReadRanchRecord, batch.ranches, remaining);
+    }
+
+    if (batch.IsEmpty())
+    {
+      // Every record was stored, the snapshot is no longer needed.
+      std::unique_lock indexLock(_indexMutex);
+      _region = boost::interprocess::mapped_region();
+      _mapping = boost::interprocess::file_mapping();
+
+      spdlog::info("Stored the snapshot to the data storage");
+      return;
+    }
+
+    try
+    {
+      _storage.Store(batch);
+    }
+    catch (const std::exception& x)
+    {
+      spdlog::error("Couldn't store the snapshot to the data storage, retrying: {}", x.what());
+      storeLock.unlock();
+
+      std::unique_lock lock(_catchUpMutex);
+      _catchUpCondition.wait_for(
+        lock,
+        stopToken,
+        CatchUpRetryDelay,
+        []()
+        {
+          return false;
+        });
+      continue;
+    }
+
+    std::unique_lock indexLock(_indexMutex);
+    Forget(batch);
+  }
+}
+
+void SnapshotDataStorage::Forget(const DataBatch& batch)
+{
+  for (const auto& [name, user] : batch.users)
+  {
+    _users.erase(name);
+  }
+  for (const auto& [characterUid, character] : batch.characters)
+  {
+    _characters.erase(characterUid);
+  }
+  for (const auto& [mountUid, mount] : batch.mounts)
+  {
+    _mounts.erase(mountUid);
+  }
+  for (const auto& [ranchUid, ranch] : batch.ranches)
+  {
+    _ranches.erase(ranchUid);
+  }
+}
+
+void SnapshotDataStorage::Forget(const DataKeys& keys)
+{
+  for (const auto& name : keys.users)
+  {
+    _users.erase(name);
+  }
+  for (const DatumUid characterUid : keys.characters)
+  {
+    _characters.erase(characterUid);
+  }
+  for (const DatumUid mountUid : keys.mounts)
+  {
+    _mounts.erase(mountUid);
+  }
+  for (const DatumUid ranchUid : keys.ranches)
+  {
+    _ranches.erase(ranchUid);
+  }
+}
+
+} // namespace alicia
@@ -0,0 +1,130 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "server/storage/MemoryDataStorage.hpp"
+
+#include <algorithm>
+
+namespace
+{
+
+//! Finds the value in the map.
+//! @returns Copy of the value, or an empty optional if the key is not in the map.
+template<typename Map, typename Key>
+auto FindValue(const Map& map, const Key& key)
+  -> std::optional<decltype(map.cbegin()->second.value)>
+{
+  const auto valueIter = map.find(key);
+  if (valueIter == map.cend())
+  {
+    return std::nullopt;
+  }
+
+  return valueIter->second.value;
+}
+
+//! Collects the keys of the values stored after the sequence.
+template<typename Map, typename Keys>
+void CollectKeysStoredAfter(const Map& map, uint64_t sequence, Keys& keys)
+{
+  for (const auto& [key, stored] : map)
+  {
+    if (stored.sequence > sequence)
+    {
+      keys.emplace_back(key);
+    }
+  }
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+std::optional<User> MemoryDataStorage::LoadUser(
+  const std::string& name)
+{
+  std::scoped_lock lock(_mutex);
+  return FindValue(_users, name);
+}
+
+std::optional<User::Character> MemoryDataStorage::LoadCharacter(
+  DatumUid characterUid)
+{
+  std::scoped_lock lock(_mutex);
+  return FindValue(_characters, characterUid);
+}
+
+std::optional<User::Mount> MemoryDataStorage::LoadMount(
+  DatumUid mountUid)
+{
+  std::scoped_lock lock(_mutex);
+  return FindValue(_mounts, mountUid);
+}
+
+std::optional<User::Ranch> MemoryDataStorage::LoadRanch(
+  DatumUid ranchUid)
+{
+  std::scoped_lock lock(_mutex);
+  return FindValue(_ranches, ranchUid);
+}
+
+uint64_t MemoryDataStorage::LoadSequence()
+{
+  std::scoped_lock lock(_mutex);
+  return _sequence;
+}
+
+DataKeys MemoryDataStorage::LoadKeysStoredAfter(uint64_t sequence)
+{
+  std::scoped_lock lock(_mutex);
+
+  DataKeys keys;
+  CollectKeysStoredAfter(_users, sequence, keys.users);
+  CollectKeysStoredAfter(_characters, sequence, keys.characters);
+  CollectKeysStoredAfter(_mounts, sequence, keys.mounts);
+  CollectKeysStoredAfter(_ranches, sequence, keys.ranches);
+  return keys;
+}
+
+void MemoryDataStorage::Store(const DataBatch& batch)
+{
+  std::scoped_lock lock(_mutex);
+
+  for (const auto& [name, user] : batch.users)
+  {
+    _users[name] = {user, batch.sequence};
+  }
+  for (const auto& [characterUid, character] : batch.characters)
+  {
+    _characters[characterUid] = {character, batch.sequence};
+  }
+  for (const auto& [mountUid, mount] : batch.mounts)
+  {
+    _mounts[mountUid] = {mount, batch.sequence};
+  }
+  for (const auto& [ranchUid, ranch] : batch.ranches)
+  {
+    _ranches[ranchUid] = {ranch, batch.sequence};
+  }
+
+  _sequence = std::max(_sequence, batch.sequence);
+}
+
+} // namespace alicia
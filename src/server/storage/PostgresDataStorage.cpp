@@ -0,0 +1,341 @@
+/**
+* Alicia Server - dedicated server software
+* Copyright (C) 2024 Story Of Alicia
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+**/
+
+#include "server/storage/PostgresDataStorage.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+
+//! Kind of the item of a character.
+enum class ItemKind : int16_t
+{
+  Character = 0,
+  Horse = 1
+};
+
+//! Writes the items of the character.
+void StoreItems(
+  pqxx::work& transaction,
+  alicia::DatumUid characterUid,
+  ItemKind kind,
+  const std::vector<alicia::Item>& items)
+{
+  for (std::size_t position = 0; position < items.size(); ++position)
+  {
+    const auto& item = items[position];
+    transaction.exec_params(
+      "INSERT INTO character_items (character_uid, kind, position, uid, tid, val, item_count) "
+      "VALUES ($1, $2, $3, $4, $5, $6, $7)",
+      characterUid,
+      static_cast<int16_t>(kind),
+      static_cast<int32_t>(position),
+      item.uid,
+      item.tid,
+      item.val,
+      item.count);
+  }
+}
+
+} // anon namespace
+
+namespace alicia
+{
+
+PostgresDataStorage::PostgresDataStorage(std::string connectionString)
+  : _connectionString(std::move(connectionString))
+  , _connection(_connectionString)
+{
+  spdlog::info("Connected to the database '{}'", _connection.dbname());
+}
+
+std::optional<User> PostgresDataStorage::LoadUser(
+  const std::string& name)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto result = transaction.exec_params(
+    "SELECT token, character_uid FROM users WHERE name = $1",
+    name);
+  if (result.empty())
+  {
+    return std::nullopt;
+  }
+
+  const auto& row = result.front();
+  return User{
+    ._token = row["token"].as<std::string>(),
+    .characterUid = row["character_uid"].as<DatumUid>()};
+}
+
+std::optional<User::Character> PostgresDataStorage::LoadCharacter(
+  DatumUid characterUid)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto result = transaction.exec_params(
+    "SELECT nick_name, gender, level, carrots, age_group, status, mount_uid, ranch_uid "
+    "FROM characters WHERE uid = $1",
+    characterUid);
+  if (result.empty())
+  {
+    return std::nullopt;
+  }
+
+  const auto& row = result.front();
+  User::Character character{
+    .nickName = row["nick_name"].as<std::string>(),
+    .gender = static_cast<Gender>(row["gender"].as<int16_t>()),
+    .level = row["level"].as<uint16_t>(),
+    .carrots = row["carrots"].as<int32_t>(),
+    .ageGroup = static_cast<AgeGroup>(row["age_group"].as<int16_t>()),
+    .status = row["status"].as<std::string>(),
+    .mountUid = row["mount_uid"].as<DatumUid>(),
+    .ranchUid = row["ranch_uid"].as<DatumUid>()};
+
+  const auto items = transaction.exec_params(
+    "SELECT kind, uid, tid, val, item_count FROM character_items "
+    "WHERE character_uid = $1 ORDER BY kind, position",
+    characterUid);
+  for (const auto& itemRow : items)
+  {
+    const Item item{
+      .uid = itemRow["uid"].as<uint32_t>(),
+      .tid = itemRow["tid"].as<uint32_t>(),
+      .val = itemRow["val"].as<uint32_t>(),
+      .count = itemRow["item_count"].as<uint32_t>()};
+
+    if (static_cast<ItemKind>(itemRow["kind"].as<int16_t>()) == ItemKind::Character)
+    {
+      character.characterEquipment.emplace_back(item);
+    }
+    else
+    {
+      character.horseEquipment.emplace_back(item);
+    }
+  }
+
+  const auto horses = transaction.exec_params(
+    "SELECT mount_uid FROM character_horses "
+    "WHERE character_uid = $1 ORDER BY position",
+    characterUid);
+  for (const auto& horseRow : horses)
+  {
+    character.horses.emplace_back(horseRow["mount_uid"].as<DatumUid>());
+  }
+
+  return character;
+}
+
+std::optional<User::Mount> PostgresDataStorage::LoadMount(
+  DatumUid mountUid)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto result = transaction.exec_params(
+    "SELECT tid, name FROM mounts WHERE uid = $1",
+    mountUid);
+  if (result.empty())
+  {
+    return std::nullopt;
+  }
+
+  const auto& row = result.front();
+  return User::Mount{
+    .tid = row["tid"].as<uint32_t>(),
+    .name = row["name"].as<std::string>()};
+}
+
+std::optional<User::Ranch> PostgresDataStorage::LoadRanch(
+  DatumUid ranchUid)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto result = transaction.exec_params(
+    "SELECT name FROM ranches WHERE uid = $1",
+    ranchUid);
+  if (result.empty())
+  {
+    return std::nullopt;
+  }
+
+  const auto& row = result.front();
+  return User::Ranch{
+    .ranchName = row["name"].as<std::string>()};
+}
+
+uint64_t PostgresDataStorage::LoadSequence()
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto result = transaction.exec(
+    "SELECT sequence FROM storage_state WHERE id = 0");
+  if (result.empty())
+  {
+    return 0;
+  }
+
+  return result.front()["sequence"].as<uint64_t>();
+}
+
+DataKeys PostgresDataStorage::LoadKeysStoredAfter(uint64_t sequence)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::read_transaction transaction(GetConnection());
+
+  const auto storedSequence = static_cast<int64_t>(sequence);
+
+  DataKeys keys;
+  for (const auto& row : transaction.exec_params(
+    "SELECT name FROM users WHERE sequence > $1", storedSequence))
+  {
+    keys.users.emplace_back(row["name"].as<std::string>());
+  }
+  for (const auto& row : transaction.exec_params(
+    "SELECT uid FROM characters WHERE sequence > $1", storedSequence))
+  {
+    keys.characters.emplace_back(row["uid"].as<DatumUid>());
+  }
+  for (const auto& row : transaction.exec_params(
+    "SELECT uid FROM mounts WHERE sequence > $1", storedSequence))
+  {
+    keys.mounts.emplace_back(row["uid"].as<DatumUid>());
+  }
+  for (const auto& row : transaction.exec_params(
+    "SELECT uid FROM ranches WHERE sequence > $1", storedSequence))
+  {
+    keys.ranches.emplace_back(row["uid"].as<DatumUid>());
+  }
+
+  return keys;
+}
+
+void PostgresDataStorage::Store(const DataBatch& batch)
+{
+  std::scoped_lock lock(_mutex);
+  pqxx::work transaction(GetConnection());
+
+  // Every row is stamped with the sequence of the batch.
+  const auto sequence = static_cast<int64_t>(batch.sequence);
+
+  for (const auto& [name, user] : batch.users)
+  {
+    transaction.exec_params(
+      "INSERT INTO users (name, token, character_uid, sequence) VALUES ($1, $2, $3, $4) "
+      "ON CONFLICT (name) DO UPDATE SET "
+      "token = EXCLUDED.token, character_uid = EXCLUDED.character_uid, "
+      "sequence = EXCLUDED.sequence",
+      name,
+      user._token,
+      user.characterUid,
+      sequence);
+  }
+
+  for (const auto& [characterUid, character] : batch.characters)
+  {
+    transaction.exec_params(
+      "INSERT INTO characters "
+      "(uid, nick_name, gender, level, carrots, age_group, status, mount_uid, ranch_uid, sequence) "
+      "VALUES ($1, $2, $3, $4, $5, $6, $7, $8, $9, $10) "
+      "ON CONFLICT (uid) DO UPDATE SET "
+      "nick_name = EXCLUDED.nick_name, gender = EXCLUDED.gender, level = EXCLUDED.level, "
+      "carrots = EXCLUDED.carrots, age_group = EXCLUDED.age_group, status = EXCLUDED.status, "
+      "mount_uid = EXCLUDED.mount_uid, ranch_uid = EXCLUDED.ranch_uid, "
+      "sequence = EXCLUDED.sequence",
+      characterUid,
+      character.nickName,
+      static_cast<int16_t>(character.gender),
+      character.level,
+      character.carrots,
+      static_cast<int16_t>(character.ageGroup),
+      character.status,
+      character.mountUid,
+      character.ranchUid,
+      sequence);
+
+    // The items and the horses are replaced as a whole.
+    transaction.exec_params(
+      "DELETE FROM character_items WHERE character_uid = $1",
+      characterUid);
+    StoreItems(transaction, characterUid, ItemKind::Character, character.characterEquipment);
+    StoreItems(transaction, characterUid, ItemKind::Horse, character.horseEquipment);
+
+    transaction.exec_params(
+      "DELETE FROM character_horses WHERE character_uid = $1",
+      characterUid);
+    for (std::size_t position = 0; position < character.horses.size(); ++position)
+    {
+      transaction.exec_params(
+        "INSERT INTO character_horses (character_uid, position, mount_uid) VALUES ($1, $2, $3)",
+        characterUid,
+        static_cast<int32_t>(position),
+        character.horses[position]);
+    }
+  }
+
+  for (const auto& [mountUid, mount] : batch.mounts)
+  {
+    transaction.exec_params(
+      "INSERT INTO mounts (uid, tid, name, sequence) VALUES ($1, $2, $3, $4) "
+      "ON CONFLICT (uid) DO UPDATE SET "
+      "tid = EXCLUDED.tid, name = EXCLUDED.name, sequence = EXCLUDED.sequence",
+      mountUid,
+      mount.tid,
+      mount.name,
+      sequence);
+  }
+
+  for (const auto& [ranchUid, ranch] : batch.ranches)
+  {
+    transaction.exec_params(
+      "INSERT INTO ranches (uid, name, sequence) VALUES ($1, $2, $3) "
+      "ON CONFLICT (uid) DO UPDATE SET name = EXCLUDED.name, sequence = EXCLUDED.sequence",
+      ranchUid,
+      ranch.ranchName,
+      sequence);
+  }
+
+  // The sequence is recorded in the same transaction as the data.
+  transaction.exec_params(
+    "INSERT INTO storage_state (id, sequence) VALUES (0, $1) "
+    "ON CONFLICT (id) DO UPDATE SET "
+    "sequence = GREATEST(storage_state.sequence, EXCLUDED.sequence)",
+    sequence);
+
+  transaction.commit();
+}
+
+pqxx::connection& PostgresDataStorage::GetConnection()
+{
+  if (!_connection.is_open())
+  {
+    spdlog::warn("Lost the connection to the database, reconnecting");
+    _connection = pqxx::connection(_connectionString);
+  }
+
+  return _connection;
+}
+
+} // namespace alicia
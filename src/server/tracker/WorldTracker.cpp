@@ -4,45 +4,151 @@
 
 #include "server/tracker/WorldTracker.hpp"
 
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
 namespace alicia
 {
 
+EntityId EntityIdAllocator::Allocate()
+{
+  if (!_freeIds.empty())
+  {
+    const EntityId entityId = _freeIds.front();
+    _freeIds.pop_front();
+    _allocated[entityId - 1] = true;
+    return entityId;
+  }
+
+  // The invalid entity ID is never allocated.
+  if (_allocated.size() == std::numeric_limits<EntityId>::max())
+  {
+    throw std::runtime_error("All the entity IDs are allocated");
+  }
+
+  _allocated.emplace_back(true);
+  return static_cast<EntityId>(_allocated.size());
+}
+
+bool EntityIdAllocator::Free(EntityId entityId)
+{
+  // A stale ID freed again must not be queued for reuse twice.
+  if (!IsAllocated(entityId))
+  {
+    return false;
+  }
+
+  _allocated[entityId - 1] = false;
+  _freeIds.emplace_back(entityId);
+  return true;
+}
+
+bool EntityIdAllocator::IsAllocated(EntityId entityId) const
+{
+  if (entityId == InvalidEntityId || entityId > _allocated.size())
+  {
+    return false;
+  }
+
+  return _allocated[entityId - 1];
+}
+
 EntityId WorldTracker::AddCharacter(DatumUid character)
 {
-  _characters[character] = _nextEntityId;
-  return _nextEntityId++;
+  return Add(_characters, character);
 }
 
-EntityId WorldTracker::GetCharacterEntityId(DatumUid character)
+EntityId WorldTracker::RemoveCharacter(DatumUid character)
 {
-  const auto itr = _characters.find(character);
-  if (itr == _characters.cend())
-    return InvalidEntityId;
-  return itr->second;
+  return Remove(_characters, character);
+}
+
+EntityId WorldTracker::GetCharacterEntityId(DatumUid character) const
+{
+  return Find(_characters, character);
 }
 
 EntityId WorldTracker::AddMount(DatumUid mount)
 {
-  _mounts[mount] = _nextEntityId;
-  return _nextEntityId++;
+  return Add(_mounts, mount);
 }
 
-EntityId WorldTracker::GetMountEntityId(DatumUid mount)
+EntityId WorldTracker::RemoveMount(DatumUid mount)
 {
-  const auto itr = _mounts.find(mount);
-  if (itr == _mounts.cend())
-    return InvalidEntityId;
-  return itr->second;
+  return Remove(_mounts, mount);
 }
 
-const WorldTracker::EntityMap& WorldTracker::GetMountEntities()
+EntityId WorldTracker::GetMountEntityId(DatumUid mount) const
 {
-  return _mounts;
+  return Find(_mounts, mount);
 }
 
-const WorldTracker::EntityMap& WorldTracker::GetCharacterEntities()
+WorldTracker::Entities WorldTracker::GetMountEntities() const
 {
-  return _characters;
+  return _mounts.entities;
+}
+
+WorldTracker::Entities WorldTracker::GetCharacterEntities() const
+{
+  return _characters.entities;
+}
+
+EntityId WorldTracker::Add(EntityArray& array, DatumUid uid)
+{
+  const auto [indexItr, inserted] = array.indices.try_emplace(
+    uid, array.entities.size());
+  if (!inserted)
+  {
+    return array.entities[indexItr->second].id;
+  }
+
+  try
+  {
+    array.entities.emplace_back(Entity{
+      .uid = uid,
+      .id = _entityIds.Allocate()});
+  }
+  catch (...)
+  {
+    array.indices.erase(indexItr);
+    throw;
+  }
+
+  return array.entities.back().id;
+}
+
+EntityId WorldTracker::Remove(EntityArray& array, DatumUid uid)
+{
+  const auto indexItr = array.indices.find(uid);
+  if (indexItr == array.indices.cend())
+  {
+    return InvalidEntityId;
+  }
+
+  const std::size_t index = indexItr->second;
+  const EntityId entityId = array.entities[index].id;
+  array.indices.erase(indexItr);
+
+  // Move the last entity in place of the removed one to keep the array dense.
+  if (index != array.entities.size() - 1)
+  {
+    array.entities[index] = array.entities.back();
+    array.indices[array.entities[index].uid] = index;
+  }
+  array.entities.pop_back();
+
+  [[maybe_unused]] const bool isFreed = _entityIds.Free(entityId);
+  assert(isFreed);
+  return entityId;
+}
+
+EntityId WorldTracker::Find(const EntityArray& array, DatumUid uid)
+{
+  const auto indexItr = array.indices.find(uid);
+  if (indexItr == array.indices.cend())
+    return InvalidEntityId;
+  return array.entities[indexItr->second].id;
 }
 
 } // namespace alicia
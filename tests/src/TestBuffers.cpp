@@ -2,6 +2,7 @@
 
 #include <boost/asio/streambuf.hpp>
 
+#include <array>
 #include <cassert>
 
 namespace {
@@ -34,9 +35,46 @@ void TestBuffers()
   assert(source.GetCursor() == 8);
 }
 
+//! Perform test of string writing/reading.
+void TestStrings()
+{
+  std::array<std::byte, 64> buffer{};
+
+  alicia::SinkStream sink(buffer);
+  sink.Write(std::string("rgnt"))
+    .Write(std::string_view("ranch"))
+    .Write(std::string());
+  assert(sink.GetCursor() == 12);
+
+  alicia::SourceStream source(std::span(buffer.data(), sink.GetCursor()));
+
+  std::string nickname;
+  std::string_view ranchName;
+  std::string empty;
+  source.Read(nickname)
+    .Read(ranchName)
+    .Read(empty);
+  assert(nickname == "rgnt" && ranchName == "ranch" && empty.empty());
+  assert(source.GetCursor() == 12);
+
+  // A string without the terminator can't be read.
+  alicia::SourceStream unterminated(std::span(buffer.data(), 3));
+  bool thrown = false;
+  try
+  {
+    unterminated.Read(nickname);
+  }
+  catch (const std::overflow_error&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
 } // namespace anon
 
 int main() {
   TestBuffers();
+  TestStrings();
 }
 
@@ -0,0 +1,60 @@
+#include "libserver/command/CommandCodec.hpp"
+
+#include <cassert>
+#include <vector>
+
+namespace {
+
+  //! Fills the data with a repeating pattern.
+  std::vector<std::byte> MakeData(std::size_t size)
+  {
+    std::vector<std::byte> data(size);
+    for (std::size_t idx = 0; idx < size; ++idx)
+    {
+      data[idx] = static_cast<std::byte>(idx * 31 + 7);
+    }
+    return data;
+  }
+
+  //! Perform test of the command data decoding against the reference algorithm.
+  void TestDecode()
+  {
+    const alicia::XorCode key{
+      std::byte{0xCB}, std::byte{0x91}, std::byte{0x01}, std::byte{0xA2}};
+
+    // Cover every tail length of the wide and the scalar kernels.
+    for (std::size_t size = 0; size <= 160; ++size)
+    {
+      const auto plain = MakeData(size);
+      auto data = plain;
+
+      alicia::DecodeCommandData(data, key);
+      for (std::size_t idx = 0; idx < size; ++idx)
+      {
+        assert(data[idx] == (plain[idx] ^ key[idx % 4]));
+      }
+    }
+  }
+
+  //! Perform test of the command data encoding/decoding.
+  void TestRoundTrip()
+  {
+    const alicia::XorCode key{
+      std::byte{0x57}, std::byte{0x43}, std::byte{0x5A}, std::byte{0xA6}};
+
+    const auto plain = MakeData(4092);
+    auto data = plain;
+
+    alicia::EncodeCommandData(data, key);
+    assert(data != plain);
+
+    alicia::DecodeCommandData(data, key);
+    assert(data == plain);
+  }
+
+} // namespace anon
+
+int main() {
+  TestDecode();
+  TestRoundTrip();
+}
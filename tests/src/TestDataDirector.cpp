@@ -0,0 +1,191 @@
+#include "server/DataDirector.hpp"
+#include "server/storage/DataSnapshot.hpp"
+#include "server/storage/MemoryDataStorage.hpp"
+
+#include <cassert>
+
+namespace {
+
+//! Perform test of the data loading and the write-behind.
+void TestDataDirector()
+{
+  alicia::MemoryDataStorage storage;
+  storage.Store({
+    .characters = {{1, {.nickName = "rgnt", .carrots = 10, .mountUid = 3}}},
+    .mounts = {{3, {.tid = 0x4E21, .name = "Ramon"}}}});
+
+  alicia::DataDirector dataDirector(storage, {
+    .writeBehindInterval = 3'600'000,
+    .snapshotPath = "",
+    .journalPath = ""});
+
+  // The data are loaded from the storage on demand.
+  assert(dataDirector.GetCharacter(1)->nickName == "rgnt");
+
+  const std::array<alicia::DatumUid, 2> mountUids{3, 3};
+  {
+    const auto mounts = dataDirector.GetMounts(mountUids);
+    assert(mounts.GetSize() == 2 && mounts[1].name == "Ramon");
+  }
+
+  // Missing data are not inserted.
+  bool thrown = false;
+  try
+  {
+    const auto character = dataDirector.GetCharacter(2);
+  }
+  catch (const std::runtime_error&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // The modified data are stored with the flush.
+  dataDirector.GetCharacterMutable(1)->carrots += 5;
+  assert(storage.LoadCharacter(1)->carrots == 10);
+
+  dataDirector.Flush();
+  assert(storage.LoadCharacter(1)->carrots == 15);
+}
+
+//! Perform test of the warm start from the snapshot.
+void TestSnapshot()
+{
+  const std::filesystem::path snapshotPath = "test_snapshot.bin";
+  const alicia::Settings::DataSettings settings{
+    .writeBehindInterval = 3'600'000,
+    .snapshotPath = "",
+    .journalPath = ""};
+
+  {
+    alicia::MemoryDataStorage storage;
+    storage.Store({
+      .users = {{"rgnt", {.characterUid = 1}}},
+      .characters = {{1, {
+        .nickName = "rgnt",
+        .characterEquipment = {alicia::Item{.uid = 100, .tid = 30035, .count = 1}},
+        .mountUid = 3,
+        .horses = {3}}}}});
+
+    alicia::DataDirector dataDirector(storage, settings);
+    dataDirector.GetCharacterMutable(
+      dataDirector.GetUser("rgnt")->characterUid)->carrots = 42;
+    dataDirector.WriteSnapshot(snapshotPath);
+  }
+
+  // The data are served from the snapshot before the storage has them.
+  alicia::MemoryDataStorage storage;
+  {
+    alicia::SnapshotDataStorage snapshotStorage(snapshotPath, storage);
+    alicia::DataDirector dataDirector(snapshotStorage, settings);
+
+    const auto character = dataDirector.GetCharacter(1);
+    assert(character->nickName == "rgnt" && character->carrots == 42);
+    assert(character->characterEquipment.size() == 1);
+    assert(character->characterEquipment[0].tid == 30035);
+    assert(character->horses.size() == 1 && character->horses[0] == 3);
+    assert(dataDirector.GetUser("rgnt")->characterUid == 1);
+  }
+
+  std::filesystem::remove(snapshotPath);
+}
+
+//! Perform test of the restart with the storage flushed after the snapshot.
+void TestStaleSnapshot()
+{
+  const std::filesystem::path snapshotPath = "test_stale_snapshot.bin";
+  const alicia::Settings::DataSettings settings{
+    .writeBehindInterval = 3'600'000,
+    .snapshotPath = "",
+    .journalPath = ""};
+
+  alicia::MemoryDataStorage storage;
+  storage.Store({
+    .characters = {
+      {1, {.nickName = "rgnt", .carrots = 10}},
+      {2, {.nickName = "lgnt", .carrots = 10}}}});
+
+  {
+    alicia::DataDirector dataDirector(storage, settings);
+    dataDirector.GetCharacterMutable(1)->carrots = 20;
+    dataDirector.GetCharacterMutable(2)->carrots = 20;
+    dataDirector.WriteSnapshot(snapshotPath);
+
+    // The storage is flushed after the snapshot.
+    dataDirector.GetCharacterMutable(1)->carrots = 30;
+    dataDirector.Flush();
+  }
+
+  // Lose the modifications of the second character, as if the server crashed
+  // before they were stored.
+  storage.Store({
+    .characters = {{2, {.nickName = "lgnt", .carrots = 10}}}});
+
+  {
+    alicia::SnapshotDataStorage snapshotStorage(snapshotPath, storage);
+    alicia::DataDirector dataDirector(snapshotStorage, settings);
+
+    // The record stored after the snapshot is loaded from the storage,
+    // the rest of the snapshot is still used.
+    assert(dataDirector.GetCharacter(1)->carrots == 30);
+    assert(dataDirector.GetCharacter(2)->carrots == 20);
+
+    // The flushes continue the sequence of the storage.
+    dataDirector.GetCharacterMutable(1)->carrots = 40;
+    dataDirector.Flush();
+    assert(storage.LoadSequence() == 2);
+  }
+
+  // The snapshot doesn't overwrite the newer data in the storage.
+  assert(storage.LoadCharacter(1)->carrots == 40);
+
+  std::filesystem::remove(snapshotPath);
+}
+
+//! Perform test of the journal replay.
+void TestJournal()
+{
+  const std::filesystem::path journalPath = "test_journal.bin";
+  const alicia::Settings::DataSettings settings{
+    .writeBehindInterval = 3'600'000,
+    .snapshotPath = "",
+    .journalPath = journalPath.string(),
+    .journalInterval = 3'600'000};
+
+  alicia::MemoryDataStorage storage;
+  storage.Store({
+    .characters = {{1, {.nickName = "rgnt", .carrots = 10}}}});
+
+  {
+    alicia::DataDirector dataDirector(storage, settings);
+    dataDirector.GetCharacterMutable(1)->carrots = 20;
+    dataDirector.CommitJournal();
+    dataDirector.GetCharacterMutable(1)->carrots = 30;
+    dataDirector.CommitJournal();
+  }
+
+  // Lose the modifications stored on the destruction, as if the server crashed.
+  storage.Store({
+    .characters = {{1, {.nickName = "rgnt", .carrots = 10}}}});
+
+  {
+    // The last value in the journal is replayed.
+    alicia::DataDirector dataDirector(storage, settings);
+    assert(dataDirector.GetCharacter(1)->carrots == 30);
+
+    // The replayed data are stored.
+    dataDirector.Flush();
+    assert(storage.LoadCharacter(1)->carrots == 30);
+  }
+
+  std::filesystem::remove(journalPath);
+}
+
+} // namespace anon
+
+int main() {
+  TestDataDirector();
+  TestSnapshot();
+  TestStaleSnapshot();
+  TestJournal();
+}
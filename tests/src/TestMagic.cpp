@@ -23,9 +23,35 @@ namespace {
     assert(decoded_magic.length == magic.length);
   }
 
+  //! Perform test of the command metadata lookup.
+  void TestCommandMeta()
+  {
+    const auto& login = alicia::GetCommandMeta(alicia::CommandId::LobbyLogin);
+    assert(login.defined);
+    assert(login.name == "LobbyLogin");
+    assert(login.direction == alicia::CommandDirection::ClientToServer);
+    assert(login.maxDataSize < alicia::MaxCommandDataSize);
+
+    // The commands of an unknown structure are only bound by the frame size.
+    assert(alicia::GetCommandMeta(alicia::CommandId::RanchSnapshot).maxDataSize
+      == alicia::MaxCommandDataSize);
+
+    assert(alicia::IsCommandMuted(alicia::CommandId::RanchSnapshot));
+    assert(!alicia::IsCommandMuted(alicia::CommandId::RanchEnterRanch));
+
+    assert(alicia::IsCommandSupersedable(alicia::CommandId::RanchSnapshotNotify));
+    assert(!alicia::IsCommandSupersedable(alicia::CommandId::RanchEnterRanchOK));
+
+    // Commands not defined in the protocol.
+    const auto& unknown = alicia::GetCommandMeta(static_cast<alicia::CommandId>(0x1234));
+    assert(!unknown.defined);
+    assert(alicia::GetCommandName(static_cast<alicia::CommandId>(0x1234)) == "n/a");
+  }
+
 } // namespace anon
 
 int main() {
   TestMagic();
+  TestCommandMeta();
 }
 
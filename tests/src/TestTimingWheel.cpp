@@ -0,0 +1,60 @@
+#include "libserver/base/TimingWheel.hpp"
+
+#include <cassert>
+
+namespace {
+
+//! Perform test of the deadline expiry.
+void TestTimingWheel()
+{
+  boost::asio::io_context ioContext;
+  alicia::TimingWheel timingWheel(ioContext, std::chrono::milliseconds(100));
+
+  std::vector<alicia::TimingWheel::ClientId> expired;
+  const auto listenerId = timingWheel.AddListener(
+    [&expired](std::span<const alicia::TimingWheel::ClientId> clients)
+    {
+      expired.insert(expired.end(), clients.begin(), clients.end());
+    });
+
+  // Deadlines in the finest and in the coarser wheels.
+  timingWheel.Schedule(listenerId, 1, std::chrono::milliseconds(500));
+  timingWheel.Schedule(listenerId, 2, std::chrono::seconds(10));
+  timingWheel.Schedule(listenerId, 3, std::chrono::minutes(10));
+  timingWheel.Schedule(listenerId, 4, std::chrono::seconds(1));
+  timingWheel.Cancel(listenerId, 4);
+
+  const auto tick = [&timingWheel](std::size_t count)
+  {
+    for (std::size_t idx = 0; idx < count; ++idx)
+    {
+      timingWheel.Tick();
+    }
+  };
+
+  tick(4);
+  assert(expired.empty());
+  tick(1);
+  assert(expired == std::vector<alicia::TimingWheel::ClientId>{1});
+
+  // Extend the deadline of the client.
+  timingWheel.Schedule(listenerId, 2, std::chrono::seconds(20));
+  tick(95);
+  assert(expired.size() == 1);
+  tick(100);
+  assert(expired.size() == 1);
+  tick(5);
+  assert(expired.size() == 2 && expired[1] == 2);
+
+  // Deadline cascaded from the coarser wheels.
+  tick(6000 - 205 - 1);
+  assert(expired.size() == 2);
+  tick(1);
+  assert(expired.size() == 3 && expired[2] == 3);
+}
+
+} // namespace anon
+
+int main() {
+  TestTimingWheel();
+}
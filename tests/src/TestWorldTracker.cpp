@@ -0,0 +1,77 @@
+#include "server/tracker/WorldTracker.hpp"
+
+#include <cassert>
+
+namespace {
+
+//! Perform test of the entity ID recycling.
+void TestEntityIdRecycling()
+{
+  alicia::WorldTracker worldTracker;
+
+  const auto firstEntityId = worldTracker.AddCharacter(1);
+  const auto secondEntityId = worldTracker.AddCharacter(2);
+  const auto mountEntityId = worldTracker.AddMount(3);
+  assert(firstEntityId != alicia::InvalidEntityId);
+  assert(firstEntityId != secondEntityId && secondEntityId != mountEntityId);
+
+  // Adding the character again keeps its entity.
+  assert(worldTracker.AddCharacter(1) == firstEntityId);
+
+  // Removing the character keeps the entities dense.
+  assert(worldTracker.RemoveCharacter(1) == firstEntityId);
+  assert(worldTracker.GetCharacterEntityId(1) == alicia::InvalidEntityId);
+  assert(worldTracker.GetCharacterEntities().size() == 1);
+  assert(worldTracker.GetCharacterEntities()[0].uid == 2);
+  assert(worldTracker.RemoveCharacter(1) == alicia::InvalidEntityId);
+
+  // The freed entity ID is reused.
+  assert(worldTracker.AddCharacter(4) == firstEntityId);
+  assert(worldTracker.GetCharacterEntityId(4) == firstEntityId);
+}
+
+//! Perform test of the entity ID allocator.
+void TestEntityIdAllocator()
+{
+  alicia::EntityIdAllocator allocator;
+
+  const auto firstEntityId = allocator.Allocate();
+  const auto secondEntityId = allocator.Allocate();
+  assert(allocator.IsAllocated(firstEntityId));
+
+  // The freed IDs are reused in the order they were freed.
+  assert(allocator.Free(secondEntityId));
+  assert(allocator.Free(firstEntityId));
+  assert(!allocator.IsAllocated(firstEntityId));
+
+  // The stale IDs are not freed again.
+  assert(!allocator.Free(firstEntityId));
+  assert(!allocator.Free(alicia::InvalidEntityId));
+
+  assert(allocator.Allocate() == secondEntityId);
+  assert(allocator.Allocate() == firstEntityId);
+
+  // The IDs don't wrap around to the allocated ones.
+  for (uint32_t count = 2; count < 0xFFFF; ++count)
+  {
+    static_cast<void>(allocator.Allocate());
+  }
+
+  bool isExhausted = false;
+  try
+  {
+    static_cast<void>(allocator.Allocate());
+  }
+  catch (const std::runtime_error&)
+  {
+    isExhausted = true;
+  }
+  assert(isExhausted);
+}
+
+} // namespace anon
+
+int main() {
+  TestEntityIdRecycling();
+  TestEntityIdAllocator();
+}